@@ -13,10 +13,12 @@
 #include <hermes_shm/util/timer_mpi.h>
 #include <mpi.h>
 
+#include <filesystem>
 #include <iostream>
 
 #include "chimaera/work_orchestrator/affinity.h"
 #include "hermes/bucket.h"
+#include "hermes/data_stager/binary_stager.h"
 #include "hermes/hermes.h"
 
 namespace hapi = hermes;
@@ -207,6 +209,35 @@ void DeleteBucketTest(int nprocs, int rank, size_t bkt_per_rank,
 /** Each process deletes blobs from a single bucket */
 void DeleteBlobOneBucket(int nprocs, int rank, size_t blobs_per_rank) {}
 
+/**
+ * Each process stages in its share of a file, buffered or with O_DIRECT.
+ * Drop the page cache between runs to compare the two fairly.
+ * */
+void StageInTest(int nprocs, int rank, const std::string &path,
+                 size_t page_size, bool direct_io) {
+  MpiTimer t(MPI_COMM_WORLD);
+  size_t file_size = std::filesystem::file_size(path);
+  u32 flags = direct_io ? HERMES_STAGE_DIRECT_IO : 0;
+  hermes::Context ctx =
+      hermes::BinaryFileStager::BuildContext(page_size, flags);
+  hermes::Bucket bkt(path, ctx, file_size, HERMES_SHOULD_STAGE);
+  size_t pages = (file_size + page_size - 1) / page_size;
+  size_t pages_per_rank = (pages + nprocs - 1) / nprocs;
+  size_t off = std::min(file_size, rank * pages_per_rank * page_size);
+  size_t size = std::min(file_size - off, pages_per_rank * page_size);
+  MPI_Barrier(MPI_COMM_WORLD);
+  t.Resume();
+  if (size > 0) {
+    bkt.Prestage(off, size);
+  }
+  t.Pause();
+  GatherTimes(direct_io ? "StageInDirect" : "StageInBuffered", file_size, t);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (rank == 0) {
+    bkt.Destroy();
+  }
+}
+
 #define REQUIRE_ARGC_GE(N)                         \
   if (argc < (N)) {                                \
     HIPRINT("Requires fewer than {} params\n", N); \
@@ -232,6 +263,9 @@ void help() {
   printf("USAGE: ./api_bench create_blob_Nbkt [blobs_per_rank]\n");
   printf("USAGE: ./api_bench del_bkt [bkt_per_rank] [blobs_per_bkt]\n");
   printf("USAGE: ./api_bench del_blobs [blobs_per_rank]\n");
+  printf(
+      "USAGE: ./api_bench stage_in [path] [page_size (K/M/G)] "
+      "[direct_io (0/1)]\n");
   exit(1);
 }
 
@@ -289,6 +323,12 @@ int main(int argc, char **argv) {
       REQUIRE_ARGC(4)
       size_t blobs_per_rank = atoi(argv[2]);
       DeleteBlobOneBucket(nprocs, rank, blobs_per_rank);
+    } else if (mode == "stage_in") {
+      REQUIRE_ARGC(5)
+      std::string path = std::filesystem::absolute(argv[2]).string();
+      size_t page_size = hshm::ConfigParse::ParseSize(argv[3]);
+      bool direct_io = atoi(argv[4]);
+      StageInTest(nprocs, rank, path, page_size, direct_io);
     }
   } catch (hshm::Error &err) {
     HELOG(kFatal, "Error: {}", err.what());
@@ -0,0 +1,421 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+/**
+ * An offline simulator which replays IoStat traces against the data
+ * placement engines. Tiers are modeled from a server configuration, so
+ * placement policies can be compared without a chimaera runtime. The
+ * buffer organizer is not modeled: blobs are never demoted or evicted,
+ * so all data movement reported is writes of new data.
+ *
+ * Usage:
+ *   placement_sim [options]
+ *     --conf <server.yaml>     Server config to model tiers from
+ *     --trace <file>           Trace saved with hermes::SaveIoTrace
+ *     --dpe <policy|all>       Placement engine(s) to evaluate
+ *     --pattern <zipf|uniform|sequential>  Synthetic trace pattern
+ *     --ops <count>            Number of synthetic operations
+ *     --blobs <count>          Number of distinct synthetic blobs
+ *     --blob_size <size>       Size of each synthetic I/O
+ *     --read_ratio <float>     Fraction of synthetic I/Os which are reads
+ *     --seed <int>             Seed of the synthetic generator
+ *     --samples <count>        Number of capacity samples to report
+ *     --latency_us <float>     Latency objective of the bucket
+ *     --bandwidth_mbps <float> Throughput objective of the bucket
+ * */
+
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hermes/config_server.h"
+#include "hermes/dpe/dpe_factory.h"
+#include "hermes/io_trace.h"
+
+namespace hermes::sim {
+
+/** The options of the simulator */
+struct SimOptions {
+  std::string conf_path_;
+  std::string trace_path_;
+  std::string dpe_ = "all";
+  std::string pattern_ = "zipf";
+  size_t ops_ = 100000;
+  size_t blobs_ = 4096;
+  size_t blob_size_ = KILOBYTES(64);
+  float read_ratio_ = .75;
+  u64 seed_ = 2989248848;
+  size_t samples_ = 10;
+  PlacementObjective objective_;
+};
+
+/** A simulated tier of the storage hierarchy */
+struct SimTier {
+  DeviceInfo dev_;
+  chi::BdevStats stats_;
+  SlabStats slabs_;
+  TargetIoStats io_stats_;
+  size_t reads_ = 0;
+  size_t bytes_written_ = 0;
+  size_t bytes_read_ = 0;
+  double io_time_us_ = 0;
+  std::vector<float> util_;
+
+  /** The fraction of the tier currently in use */
+  float GetUtilization() const {
+    if (stats_.max_cap_ == 0) {
+      return 0;
+    }
+    return 1 - (float)stats_.free_ / (float)stats_.max_cap_;
+  }
+
+  /** Model the time (us) to transfer \a size bytes to or from the tier */
+  double ModelIoUs(size_t size) const {
+    return dev_.latency_ + (double)size / dev_.bandwidth_;
+  }
+};
+
+/** A simulated blob */
+struct SimBlob {
+  size_t size_ = 0;
+  std::vector<SubPlacement> plcmnts_;
+};
+
+/** Replays a trace against a single placement engine */
+class PlacementSim {
+ public:
+  PlacementPolicy policy_;
+  PlacementObjective objective_;
+  std::vector<SimTier> tiers_;
+  std::vector<TargetInfo> targets_;
+  std::unordered_map<TargetId, size_t> tier_map_;
+  std::unordered_map<BlobId, SimBlob> blobs_;
+  size_t misses_ = 0;
+  size_t reads_ = 0;
+  size_t failed_placements_ = 0; /**< Placements which had to spill */
+  size_t unplaced_bytes_ = 0;    /**< Bytes no tier had room for */
+  size_t bytes_written_ = 0;
+
+ public:
+  /** Model the tiers of \a conf */
+  PlacementSim(const ServerConfig &conf, PlacementPolicy policy,
+               const PlacementObjective &objective)
+      : policy_(policy), objective_(objective), tiers_(conf.devices_.size()) {
+    targets_.resize(conf.devices_.size());
+    for (size_t i = 0; i < conf.devices_.size(); ++i) {
+      SimTier &tier = tiers_[i];
+      tier.dev_ = conf.devices_[i];
+      if (tier.dev_.bandwidth_ <= 0) {
+        HILOG(kWarning, "Device {} has no bandwidth, assuming 100MBps",
+              tier.dev_.dev_name_);
+        tier.dev_.bandwidth_ = 100;
+      }
+      tier.stats_.free_ = tier.dev_.capacity_;
+      tier.stats_.max_cap_ = tier.dev_.capacity_;
+      tier.stats_.write_bw_ = tier.dev_.bandwidth_;
+      tier.stats_.write_latency_ = tier.dev_.latency_;
+      tier.slabs_.Init(tier.dev_.slab_sizes_);
+      TargetInfo &target = targets_[i];
+      target.id_ = TargetId(0, 0, i + 1);
+      target.stats_ = &tier.stats_;
+      target.slabs_ = &tier.slabs_;
+      target.io_stats_ = &tier.io_stats_;
+      tier_map_[target.id_] = i;
+    }
+  }
+
+  /** Replay \a trace, sampling capacity \a samples times */
+  void Replay(const std::vector<IoStat> &trace, size_t samples) {
+    size_t sample_period = std::max<size_t>(trace.size() / samples, 1);
+    for (size_t i = 0; i < trace.size(); ++i) {
+      const IoStat &stat = trace[i];
+      if (stat.type_ == IoType::kWrite) {
+        Write(stat);
+      } else if (stat.type_ == IoType::kRead) {
+        Read(stat);
+      }
+      if ((i + 1) % sample_period == 0) {
+        for (SimTier &tier : tiers_) {
+          tier.util_.emplace_back(tier.GetUtilization());
+        }
+      }
+    }
+  }
+
+  /** Print the statistics of the replay */
+  void Report() {
+    double total_us = 0;
+    HILOG(kInfo, "==== Placement policy: {} ====",
+          PlacementPolicyConv::to_str(policy_));
+    for (SimTier &tier : tiers_) {
+      float hit_ratio = reads_ ? (float)tier.reads_ / reads_ : 0;
+      HILOG(kInfo,
+            "Tier {}: hit_ratio={} bytes_written={} bytes_read={} "
+            "io_time_sec={} final_util={}",
+            tier.dev_.dev_name_, hit_ratio, tier.bytes_written_,
+            tier.bytes_read_, tier.io_time_us_ / 1000000,
+            tier.GetUtilization());
+      total_us += tier.io_time_us_;
+    }
+    for (SimTier &tier : tiers_) {
+      std::stringstream ss;
+      for (float util : tier.util_) {
+        ss << std::fixed << std::setprecision(2) << util << " ";
+      }
+      HILOG(kInfo, "Tier {} capacity over time: {}", tier.dev_.dev_name_,
+            ss.str());
+    }
+    HILOG(kInfo,
+          "Reads={} misses={} failed_placements={} unplaced_bytes={} "
+          "bytes_written={} (no demotion or eviction is modeled) "
+          "modeled_io_time_sec={}",
+          reads_, misses_, failed_placements_, unplaced_bytes_,
+          bytes_written_, total_us / 1000000);
+  }
+
+ private:
+  /** Simulate a PUT */
+  void Write(const IoStat &stat) {
+    SimBlob &blob = blobs_[stat.blob_id_];
+    if (stat.blob_size_ > blob.size_) {
+      Place(blob, stat.blob_size_ - blob.size_);
+      blob.size_ = stat.blob_size_;
+    }
+    Transfer(blob, stat.blob_size_, true);
+  }
+
+  /** Simulate a GET. Unknown blobs are staged in from the backend. */
+  void Read(const IoStat &stat) {
+    ++reads_;
+    auto it = blobs_.find(stat.blob_id_);
+    if (it == blobs_.end()) {
+      ++misses_;
+      SimBlob &blob = blobs_[stat.blob_id_];
+      SimTier &backend = tiers_.back();
+      backend.io_time_us_ += backend.ModelIoUs(stat.blob_size_);
+      Place(blob, stat.blob_size_);
+      blob.size_ = stat.blob_size_;
+      Transfer(blob, stat.blob_size_, true);
+      return;
+    }
+    SimBlob &blob = it->second;
+    // The read is served by the tier holding most of the blob
+    size_t best = 0, best_size = 0;
+    for (SubPlacement &plcmnt : blob.plcmnts_) {
+      if (plcmnt.size_ > best_size) {
+        best = tier_map_[plcmnt.tid_];
+        best_size = plcmnt.size_;
+      }
+    }
+    if (best_size) {
+      tiers_[best].reads_ += 1;
+    }
+    Transfer(blob, stat.blob_size_, false);
+  }
+
+  /** Place \a size more bytes of \a blob in the tiers */
+  void Place(SimBlob &blob, size_t size) {
+    std::vector<TargetInfo> targets = targets_;
+    std::vector<PlacementSchema> schema_vec;
+    Context ctx;
+    ctx.dpe_ = policy_;
+    ctx.objective_ = objective_;
+    Dpe *dpe = DpeFactory::Get(policy_);
+    Status status = dpe->Placement({size}, targets, ctx, schema_vec);
+    bool failed = false;
+    if (status.Fail() || schema_vec.empty()) {
+      // Spill to the last tier, as the runtime's fallback target does
+      failed = true;
+      schema_vec.clear();
+      schema_vec.emplace_back();
+      schema_vec.back().AddSubPlacement(size, targets_.back().id_);
+    }
+    for (SubPlacement &plcmnt : schema_vec[0].plcmnts_) {
+      if (plcmnt.size_ == 0) {
+        continue;
+      }
+      unplaced_bytes_ +=
+          Allocate(blob, tier_map_[plcmnt.tid_], plcmnt.size_, failed);
+    }
+    if (failed) {
+      ++failed_placements_;
+    }
+  }
+
+  /**
+   * Allocate \a size bytes of \a blob on tier \a idx. What the tier can't
+   * hold spills to the tiers after it, and \a spilled is set.
+   *
+   * @return the number of bytes no tier could hold
+   * */
+  size_t Allocate(SimBlob &blob, size_t idx, size_t size, bool &spilled) {
+    for (; idx < tiers_.size(); ++idx) {
+      SimTier &tier = tiers_[idx];
+      size_t data_size = size;
+      size_t alloc = tier.slabs_.RoundUp(size);
+      if (alloc > tier.stats_.free_) {
+        // Only part of the data fits, without slab rounding
+        data_size = std::min<size_t>(size, tier.stats_.free_);
+        alloc = data_size;
+      }
+      if (data_size > 0) {
+        tier.stats_.free_ -= alloc;
+        tier.slabs_.Allocated(alloc);
+        blob.plcmnts_.emplace_back(data_size, targets_[idx].id_);
+        size -= data_size;
+      }
+      if (size == 0) {
+        break;
+      }
+      spilled = true;
+    }
+    return size;
+  }
+
+  /** Model the transfer of \a size bytes to or from \a blob */
+  void Transfer(SimBlob &blob, size_t size, bool is_write) {
+    size_t rem = size;
+    for (SubPlacement &plcmnt : blob.plcmnts_) {
+      if (rem == 0) {
+        break;
+      }
+      size_t io_size = std::min(rem, plcmnt.size_);
+      SimTier &tier = tiers_[tier_map_[plcmnt.tid_]];
+      tier.io_time_us_ += tier.ModelIoUs(io_size);
+      if (is_write) {
+        tier.bytes_written_ += io_size;
+        bytes_written_ += io_size;
+      } else {
+        tier.bytes_read_ += io_size;
+      }
+      rem -= io_size;
+    }
+  }
+};
+
+/** Generate a synthetic trace */
+static std::vector<IoStat> GenerateTrace(const SimOptions &opts) {
+  std::vector<IoStat> trace;
+  trace.reserve(opts.ops_);
+  std::mt19937_64 rng(opts.seed_);
+  std::uniform_real_distribution<double> coin(0, 1);
+  // Zipfian CDF over the blobs (s = 0.99)
+  std::vector<double> cdf(opts.blobs_);
+  double sum = 0;
+  for (size_t i = 0; i < opts.blobs_; ++i) {
+    sum += 1.0 / std::pow((double)(i + 1), 0.99);
+    cdf[i] = sum;
+  }
+  TagId tag_id(0, 0, 1);
+  for (size_t i = 0; i < opts.ops_; ++i) {
+    size_t blob_idx;
+    if (opts.pattern_ == "sequential") {
+      blob_idx = i % opts.blobs_;
+    } else if (opts.pattern_ == "uniform") {
+      blob_idx = rng() % opts.blobs_;
+    } else {
+      double r = coin(rng) * sum;
+      blob_idx = std::lower_bound(cdf.begin(), cdf.end(), r) - cdf.begin();
+      blob_idx = std::min(blob_idx, opts.blobs_ - 1);
+    }
+    IoType type = coin(rng) < opts.read_ratio_ ? IoType::kRead : IoType::kWrite;
+    trace.emplace_back(type, BlobId(0, 0, blob_idx + 1), tag_id,
+                       opts.blob_size_, 0);
+    trace.back().id_ = i;
+  }
+  return trace;
+}
+
+/** Parse the command line */
+static SimOptions ParseArgs(int argc, char **argv) {
+  SimOptions opts;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string key(argv[i]), val(argv[i + 1]);
+    if (key == "--conf") {
+      opts.conf_path_ = val;
+    } else if (key == "--trace") {
+      opts.trace_path_ = val;
+    } else if (key == "--dpe") {
+      opts.dpe_ = val;
+    } else if (key == "--pattern") {
+      opts.pattern_ = val;
+    } else if (key == "--ops") {
+      opts.ops_ = std::stoul(val);
+    } else if (key == "--blobs") {
+      opts.blobs_ = std::max<size_t>(std::stoul(val), 1);
+    } else if (key == "--blob_size") {
+      opts.blob_size_ = hshm::ConfigParse::ParseSize(val);
+    } else if (key == "--read_ratio") {
+      opts.read_ratio_ = std::stof(val);
+    } else if (key == "--seed") {
+      opts.seed_ = std::stoull(val);
+    } else if (key == "--samples") {
+      opts.samples_ = std::max<size_t>(std::stoul(val), 1);
+    } else if (key == "--latency_us") {
+      opts.objective_.max_latency_us_ = std::stof(val);
+    } else if (key == "--bandwidth_mbps") {
+      opts.objective_.min_bandwidth_mbps_ = std::stof(val);
+    } else {
+      HELOG(kFatal, "Unknown option: {}", key);
+    }
+  }
+  return opts;
+}
+
+}  // namespace hermes::sim
+
+int main(int argc, char **argv) {
+  using namespace hermes::sim;
+  SimOptions opts = ParseArgs(argc, argv);
+  hermes::ServerConfig conf;
+  if (opts.conf_path_.empty()) {
+    conf.LoadDefault();
+  } else {
+    conf.LoadFromFile(opts.conf_path_);
+  }
+
+  // Load or generate the trace
+  std::vector<hermes::IoStat> trace;
+  if (!opts.trace_path_.empty()) {
+    if (!hermes::LoadIoTrace(opts.trace_path_, trace)) {
+      return 1;
+    }
+  } else {
+    trace = GenerateTrace(opts);
+  }
+  HILOG(kInfo, "Replaying {} I/Os over {} tiers", trace.size(),
+        conf.devices_.size());
+
+  // Replay the trace against each placement engine
+  std::vector<hermes::PlacementPolicy> policies;
+  if (opts.dpe_ == "all") {
+    policies = {hermes::PlacementPolicy::kRandom,
+                hermes::PlacementPolicy::kRoundRobin,
+                hermes::PlacementPolicy::kMinimizeIoTime,
+                hermes::PlacementPolicy::kPowerOfTwo,
+                hermes::PlacementPolicy::kDeadlineAware};
+  } else {
+    policies = {hermes::PlacementPolicyConv::to_enum(opts.dpe_)};
+  }
+  for (hermes::PlacementPolicy policy : policies) {
+    if (policy == hermes::PlacementPolicy::kNone) {
+      policy = conf.dpe_.default_policy_;
+    }
+    PlacementSim sim(conf, policy, opts.objective_);
+    sim.Replay(trace, opts.samples_);
+    sim.Report();
+  }
+  return 0;
+}
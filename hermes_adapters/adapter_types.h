@@ -43,6 +43,8 @@ enum class AdapterMode {
 struct AdapterObjectConfig {
   AdapterMode mode_;
   size_t page_size_;
+  bool direct_io_ = false; /**< Stage with O_DIRECT, bypassing the page cache */
+  bool mmap_ = false;      /**< Stage in through a mapping of the file */
 };
 
 /** Adapter Mode converter */
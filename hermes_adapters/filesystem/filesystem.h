@@ -20,6 +20,7 @@
 #include <ftw.h>
 // #include <mpi.h>
 
+#include <cerrno>
 #include <filesystem>
 #include <future>
 #include <set>
@@ -29,6 +30,7 @@
 #include "filesystem_mdm.h"
 #include "hermes/bucket.h"
 #include "hermes/data_stager/binary_stager.h"
+#include "hermes/data_stager/mmap_stager.h"
 #include "hermes/hermes.h"
 #include "hermes_adapters/adapter_types.h"
 #include "hermes_adapters/mapper/mapper_factory.h"
@@ -95,8 +97,17 @@ class Filesystem : public FilesystemIoClient {
       // Update page size
       stat.page_size_ = mdm->GetAdapterPageSize(path);
       // Bucket parameters
-      ctx.bkt_params_ =
-          hermes::BinaryFileStager::BuildFileParams(stat.page_size_);
+      u32 stage_flags = 0;
+      if (mdm->GetAdapterDirectIo(path)) {
+        stage_flags |= HERMES_STAGE_DIRECT_IO;
+      }
+      if (mdm->GetAdapterMmap(path)) {
+        ctx.bkt_params_ = hermes::MmapFileStager::BuildFileParams(
+            stat.page_size_, stage_flags);
+      } else {
+        ctx.bkt_params_ = hermes::BinaryFileStager::BuildFileParams(
+            stat.page_size_, stage_flags);
+      }
       // Get or create the bucket
       if (stat.hflags_.Any(HERMES_FS_TRUNC)) {
         // The file was opened with TRUNCATION
@@ -393,14 +404,14 @@ class Filesystem : public FilesystemIoClient {
     }
   }
 
-  /** sync */
+  /**
+   * sync: wait for the file's dirty blobs to reach the backend and for
+   * the backend to make them durable. Fails with EIO otherwise.
+   * */
   int Sync(File &f, AdapterStat &stat) {
-    if (HERMES_CLIENT_CONF.flushing_mode_ == FlushingMode::kSync) {
-      // NOTE(llogan): only for the unit tests
-      // Please don't enable synchronous flushing
-      stat.bkt_id_.Flush();
-      // CHI_ADMIN->Flush(HSHM_MCTX,
-      //                  chi::DomainQuery::GetGlobalBcast());
+    if (!stat.bkt_id_.Flush()) {
+      errno = EIO;
+      return -1;
     }
     return 0;
   }
@@ -414,7 +425,11 @@ class Filesystem : public FilesystemIoClient {
 
   /** close */
   int Close(File &f, AdapterStat &stat) {
-    Sync(f, stat);
+    if (HERMES_CLIENT_CONF.flushing_mode_ == FlushingMode::kSync) {
+      // NOTE(llogan): only for the unit tests
+      // Please don't enable synchronous flushing
+      Sync(f, stat);
+    }
     auto mdm = HERMES_FS_METADATA_MANAGER;
     FilesystemIoClientState fs_ctx(&mdm->fs_mdm_, (void *)&stat);
     HermesClose(f, stat, fs_ctx);
@@ -57,6 +57,18 @@ class MetadataManager {
     return HERMES_CLIENT_CONF.GetAdapterConfig(path).page_size_;
   }
 
+  /** Whether a particular file is staged with direct I/O */
+  bool GetAdapterDirectIo(const std::string& path) {
+    ScopedRwReadLock md_lock(lock_, 4);
+    return HERMES_CLIENT_CONF.GetAdapterConfig(path).direct_io_;
+  }
+
+  /** Whether a particular file is staged in through a mapping */
+  bool GetAdapterMmap(const std::string& path) {
+    ScopedRwReadLock md_lock(lock_, 5);
+    return HERMES_CLIENT_CONF.GetAdapterConfig(path).mmap_;
+  }
+
   /**
    * Create a metadata entry for filesystem adapters given File handler.
    * @param f original file handler of the file on the destination
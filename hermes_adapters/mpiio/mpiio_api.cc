@@ -467,8 +467,10 @@ int HERMES_DECL(MPI_File_sync)(MPI_File fh) {
     HILOG(kDebug, "Intercept MPI_File_sync");
     File f;
     f.hermes_mpi_fh_ = fh;
-    fs_api->Sync(f, stat_exists);
-    return 0;
+    if (fs_api->Sync(f, stat_exists) < 0) {
+      return MPI_ERR_IO;
+    }
+    return MPI_SUCCESS;
   }
 #endif
   return real_api->MPI_File_sync(fh);
@@ -15,6 +15,7 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <iostream>
@@ -45,6 +46,10 @@ typedef ssize_t (*pwrite_t)(int fd, const void *buf, size_t count,
 typedef ssize_t (*pread64_t)(int fd, void *buf, size_t count, off64_t offset);
 typedef ssize_t (*pwrite64_t)(int fd, const void *buf, size_t count,
                               off64_t offset);
+typedef ssize_t (*preadv_t)(int fd, const struct iovec *iov, int iovcnt,
+                            off_t offset);
+typedef ssize_t (*pwritev_t)(int fd, const struct iovec *iov, int iovcnt,
+                             off_t offset);
 typedef off_t (*lseek_t)(int fd, off_t offset, int whence);
 typedef off64_t (*lseek64_t)(int fd, off64_t offset, int whence);
 
@@ -71,6 +76,7 @@ typedef int (*stat64_t)(const char *pathname, struct stat64 *__stat_buf);
 typedef int (*fstat64_t)(int __filedesc, struct stat64 *__stat_buf);
 
 typedef int (*fsync_t)(int fd);
+typedef int (*fdatasync_t)(int fd);
 typedef int (*close_t)(int fd);
 
 typedef int (*fchdir_t)(int fd);
@@ -131,6 +137,10 @@ class PosixApi : public RealApi {
   pread64_t pread64 = nullptr;
   /** pwrite64 */
   pwrite64_t pwrite64 = nullptr;
+  /** preadv */
+  preadv_t preadv = nullptr;
+  /** pwritev */
+  pwritev_t pwritev = nullptr;
   /** lseek */
   lseek_t lseek = nullptr;
   /** lseek64 */
@@ -164,6 +174,8 @@ class PosixApi : public RealApi {
 
   /** fsync */
   fsync_t fsync = nullptr;
+  /** fdatasync */
+  fdatasync_t fdatasync = nullptr;
   /** close */
   close_t close = nullptr;
   /** flock */
@@ -200,6 +212,10 @@ class PosixApi : public RealApi {
     REQUIRE_API(pread64)
     pwrite64 = (pwrite64_t)dlsym(real_lib_, "pwrite64");
     REQUIRE_API(pwrite64)
+    preadv = (preadv_t)dlsym(real_lib_, "preadv");
+    REQUIRE_API(preadv)
+    pwritev = (pwritev_t)dlsym(real_lib_, "pwritev");
+    REQUIRE_API(pwritev)
     lseek = (lseek_t)dlsym(real_lib_, "lseek");
     REQUIRE_API(lseek)
     lseek64 = (lseek64_t)dlsym(real_lib_, "lseek64");
@@ -229,6 +245,8 @@ class PosixApi : public RealApi {
 
     fsync = (fsync_t)dlsym(real_lib_, "fsync");
     REQUIRE_API(fsync)
+    fdatasync = (fdatasync_t)dlsym(real_lib_, "fdatasync");
+    REQUIRE_API(fdatasync)
     close = (close_t)dlsym(real_lib_, "close");
     REQUIRE_API(close)
     flock = (flock_t)dlsym(real_lib_, "flock");
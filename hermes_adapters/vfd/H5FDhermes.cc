@@ -109,6 +109,8 @@ static herr_t H5FD__hermes_read(H5FD_t *_file, H5FD_mem_t type, hid_t fapl_id,
                                 haddr_t addr, size_t size, void *buf);
 static herr_t H5FD__hermes_write(H5FD_t *_file, H5FD_mem_t type, hid_t fapl_id,
                                  haddr_t addr, size_t size, const void *buf);
+static herr_t H5FD__hermes_flush(H5FD_t *_file, hid_t dxpl_id,
+                                 hbool_t closing);
 
 static const H5FD_class_t H5FD_hermes_g = {
     H5FD_CLASS_VERSION,   /* struct version       */
@@ -144,7 +146,7 @@ static const H5FD_class_t H5FD_hermes_g = {
     NULL,                 /* write_vector         */
     NULL,                 /* read_selection       */
     NULL,                 /* write_selection      */
-    NULL,                 /* flush                */
+    H5FD__hermes_flush,   /* flush                */
     NULL,                 /* truncate             */
     NULL,                 /* lock                 */
     NULL,                 /* unlock               */
@@ -507,6 +509,40 @@ static herr_t H5FD__hermes_write(H5FD_t *_file, H5FD_mem_t type, hid_t dxpl_id,
   return ret_value;
 } /* end H5FD__hermes_write() */
 
+/*-------------------------------------------------------------------------
+ * Function:    H5FD__hermes_flush
+ *
+ * Purpose:     Makes the data buffered for the file in Hermes durable in
+ *              the backend file. HDF5 also calls this with CLOSING set
+ *              right before closing the file; close itself only flushes
+ *              in synchronous flushing mode, so the flush happens here.
+ *
+ * Return:      SUCCEED/FAIL
+ *
+ *-------------------------------------------------------------------------
+ */
+static herr_t H5FD__hermes_flush(H5FD_t *_file, hid_t dxpl_id,
+                                 hbool_t closing) {
+  (void)dxpl_id;
+  (void)closing;
+  H5FD_hermes_t *file = (H5FD_hermes_t *)_file;
+  herr_t ret_value = SUCCEED;
+#ifdef USE_HERMES
+  bool stat_exists;
+  auto fs_api = HERMES_POSIX_FS;
+  File f;
+  f.hermes_fd_ = file->fd;
+  int ret = fs_api->Sync(f, stat_exists);
+  HILOG(kDebug, "");
+#else
+  int ret = fsync(file->fd);
+#endif
+  if (ret < 0) {
+    ret_value = FAIL;
+  }
+  return ret_value;
+} /* end H5FD__hermes_flush() */
+
 /*
  * Stub routines for dynamic plugin loading
  */
@@ -89,6 +89,14 @@ class Bucket {
    * */
   Context &GetContext() { return ctx_; }
 
+  /**
+   * Set the latency / throughput objective used to place this
+   * bucket's blobs
+   * */
+  void SetObjective(const PlacementObjective &objective) {
+    ctx_.objective_ = objective;
+  }
+
   /**
    * Attach a trait to the bucket
    * */
@@ -205,6 +213,10 @@ class Bucket {
     if constexpr (!PARTIAL) {
       hermes_flags.SetBits(HERMES_BLOB_REPLACE);
     }
+    // Inherit the placement objective of the bucket
+    if (!ctx.objective_.IsSet()) {
+      ctx.objective_ = ctx_.objective_;
+    }
     FullPtr<PutBlobTask> task;
     task = mdm_->AsyncPutBlob(mctx_, chi::DomainQuery::GetDynamic(), id_,
                               blob_name_buf, blob_id, blob_off, blob.size(),
@@ -549,8 +561,46 @@ class Bucket {
     return mdm_->TagGetContainedBlobIds(mctx_, DomainQuery::GetDynamic(), id_);
   }
 
-  /** Flush the bucket */
-  void Flush() { mdm_->TagFlush(mctx_, DomainQuery::GetDynamic(), id_); }
+  /**
+   * Flush the bucket's dirty blobs and sync its backend.
+   * @return false if the data could not be made durable
+   * */
+  bool Flush() {
+    return mdm_->TagFlush(mctx_, DomainQuery::GetDynamic(), id_);
+  }
+
+  /**
+   * Flush the bucket without blocking. Wait on the returned task, then
+   * delete it with CHI_CLIENT->DelTask.
+   * */
+  FullPtr<TagFlushTask> AsyncFlush() {
+    return mdm_->AsyncTagFlush(mctx_, DomainQuery::GetDynamic(), id_);
+  }
+
+  /**
+   * Stage [off, off + size) of the bucket's backend in ahead of use.
+   * A size of 0 stages in up to the end of the backend. Staged blobs are
+   * placed with \a score. The bucket must have a stager.
+   * */
+  void Prestage(size_t off = 0, size_t size = 0, float score = 1) {
+    mdm_->Prestage(
+        mctx_,
+        DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
+        id_, off, size, score);
+  }
+
+  /**
+   * Prestage without blocking. The task's GetProgress() reports the
+   * fraction staged in so far. Wait on the returned task, then delete it
+   * with CHI_CLIENT->DelTask.
+   * */
+  FullPtr<PrestageTask> AsyncPrestage(size_t off = 0, size_t size = 0,
+                                      float score = 1) {
+    return mdm_->AsyncPrestage(
+        mctx_,
+        DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
+        id_, off, size, score);
+  }
 };
 
 }  // namespace hermes
@@ -0,0 +1,188 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_INCLUDE_HERMES_COMPRESSOR_H_
+#define HERMES_INCLUDE_HERMES_COMPRESSOR_H_
+
+#include <chimaera/chimaera_types.h>
+
+#include <cmath>
+#include <string>
+
+#ifdef HERMES_ENABLE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HERMES_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace hermes {
+
+/** The codecs a target can compress its buffers with */
+enum class CompressCodec : u8 { kNone = 0, kLz4 = 1, kZstd = 2 };
+
+/** Compresses blobs placed on targets that are configured for it */
+class Compressor {
+ public:
+  /** Bytes sampled by the entropy check */
+  static constexpr size_t kSampleSize = 4096;
+  /** Bits per byte above which data is treated as incompressible */
+  static constexpr float kMaxEntropy = 7.5;
+  /** Smallest saving (as a fraction of the data) worth keeping */
+  static constexpr float kMinSaving = .125;
+
+  /** Parse a codec name. Codecs this build lacks become kNone. */
+  static CompressCodec FromString(const std::string &name) {
+    if (name == "lz4") {
+      if (IsAvailable(CompressCodec::kLz4)) {
+        return CompressCodec::kLz4;
+      }
+    } else if (name == "zstd") {
+      if (IsAvailable(CompressCodec::kZstd)) {
+        return CompressCodec::kZstd;
+      }
+    } else if (name.empty() || name == "none") {
+      return CompressCodec::kNone;
+    }
+    HELOG(kWarning, "Compression codec {} is not available", name);
+    return CompressCodec::kNone;
+  }
+
+  /** Whether this build includes \a codec */
+  static bool IsAvailable(CompressCodec codec) {
+    switch (codec) {
+      case CompressCodec::kNone:
+        return true;
+      case CompressCodec::kLz4:
+#ifdef HERMES_ENABLE_LZ4
+        return true;
+#else
+        return false;
+#endif
+      case CompressCodec::kZstd:
+#ifdef HERMES_ENABLE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+  }
+
+  /**
+   * Estimate whether \a data is worth compressing from the byte entropy
+   * of an evenly spaced sample. Already compressed or random data is
+   * close to 8 bits per byte.
+   * */
+  static bool IsCompressible(const char *data, size_t size) {
+    if (size == 0) {
+      return false;
+    }
+    size_t count[256] = {0};
+    size_t samples = std::min(size, kSampleSize);
+    size_t stride = size / samples;
+    for (size_t i = 0; i < samples; ++i) {
+      ++count[(u8)data[i * stride]];
+    }
+    float entropy = 0;
+    for (size_t c : count) {
+      if (c) {
+        float p = (float)c / samples;
+        entropy -= p * std::log2(p);
+      }
+    }
+    return entropy < kMaxEntropy;
+  }
+
+  /** The largest output compressing \a size bytes can produce */
+  static size_t GetBound(CompressCodec codec, size_t size) {
+    switch (codec) {
+#ifdef HERMES_ENABLE_LZ4
+      case CompressCodec::kLz4:
+        return LZ4_compressBound((int)size);
+#endif
+#ifdef HERMES_ENABLE_ZSTD
+      case CompressCodec::kZstd:
+        return ZSTD_compressBound(size);
+#endif
+      default:
+        return size;
+    }
+  }
+
+  /**
+   * Compress \a size bytes of \a src into \a dst of \a dst_size bytes.
+   *
+   * @return the compressed size, or 0 on failure
+   * */
+  static size_t Compress(CompressCodec codec, const char *src, size_t size,
+                         char *dst, size_t dst_size) {
+    switch (codec) {
+#ifdef HERMES_ENABLE_LZ4
+      case CompressCodec::kLz4: {
+        int ret = LZ4_compress_default(src, dst, (int)size, (int)dst_size);
+        return ret > 0 ? (size_t)ret : 0;
+      }
+#endif
+#ifdef HERMES_ENABLE_ZSTD
+      case CompressCodec::kZstd: {
+        size_t ret = ZSTD_compress(dst, dst_size, src, size, 1);
+        return ZSTD_isError(ret) ? 0 : ret;
+      }
+#endif
+      default:
+        return 0;
+    }
+  }
+
+  /**
+   * Decompress the first \a dst_size bytes of the data compressed in
+   * \a src. Only the prefix that is needed is decoded.
+   *
+   * @return the number of bytes decompressed, or 0 on failure
+   * */
+  static size_t Decompress(CompressCodec codec, const char *src, size_t size,
+                           char *dst, size_t dst_size) {
+    switch (codec) {
+#ifdef HERMES_ENABLE_LZ4
+      case CompressCodec::kLz4: {
+        int ret = LZ4_decompress_safe_partial(src, dst, (int)size,
+                                              (int)dst_size, (int)dst_size);
+        return ret > 0 ? (size_t)ret : 0;
+      }
+#endif
+#ifdef HERMES_ENABLE_ZSTD
+      case CompressCodec::kZstd: {
+        ZSTD_DCtx *dctx = ZSTD_createDCtx();
+        ZSTD_inBuffer in = {src, size, 0};
+        ZSTD_outBuffer out = {dst, dst_size, 0};
+        size_t ret = 1;
+        while (ret != 0 && out.pos < out.size && in.pos < in.size) {
+          ret = ZSTD_decompressStream(dctx, &out, &in);
+          if (ZSTD_isError(ret)) {
+            out.pos = 0;
+            break;
+          }
+        }
+        ZSTD_freeDCtx(dctx);
+        return out.pos;
+      }
+#endif
+      default:
+        return 0;
+    }
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_INCLUDE_HERMES_COMPRESSOR_H_
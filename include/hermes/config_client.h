@@ -225,6 +225,12 @@ class ClientConfig : public BaseConfig {
       conf.page_size_ = hshm::ConfigParse::ParseSize(
           yaml_conf["page_size"].as<std::string>());
     }
+    if (yaml_conf["direct_io"]) {
+      conf.direct_io_ = yaml_conf["direct_io"].as<bool>();
+    }
+    if (yaml_conf["mmap"]) {
+      conf.mmap_ = yaml_conf["mmap"].as<bool>();
+    }
     SetAdapterConfig(path, conf);
   }
 };
@@ -10,5 +10,7 @@ const inline char* kHermesClientDefaultConfigStr =
 "file_adapter_configs:\n"
 "  - path: \"/*\"\n"
 "    page_size: 1MB\n"
-"    mode: kDefault\n";
+"    mode: kDefault\n"
+"    direct_io: false\n"
+"    mmap: false\n";
 #endif  // HRUN_SRC_CONFIG_HERMES_CLIENT_DEFAULT_H_
\ No newline at end of file
@@ -54,6 +54,8 @@ struct DeviceInfo {
   bool is_shared_;
   /** BORG's minimum and maximum capacity threshold for device */
   f32 borg_min_thresh_, borg_max_thresh_;
+  /** Codec to compress blobs placed on the device with ("none" is off) */
+  std::string compress_;
 };
 
 /**
@@ -73,9 +75,19 @@ struct DpeInfo {
 struct BorgInfo {
   /** The number of buffer organizer threads. */
   int num_threads_;
-  /** Interval (seconds) where blobs are checked for flushing */
+  /** Interval (ms) where blobs are checked for flushing */
   size_t flush_period_;
-  /** Interval (seconds) where blobs are checked for re-organization */
+  /** Maximum number of dirty blobs flushed per sweep (0 is unlimited) */
+  size_t flush_budget_;
+  /** Bandwidth (bytes/sec) available to flushing (0 is unlimited) */
+  size_t flush_bandwidth_;
+  /** Time (ms) without foreground I/O before a target is idle */
+  size_t flush_idle_time_;
+  /** Dirty fraction of capacity below which flushing waits for idle */
+  float flush_dirty_low_;
+  /** Dirty fraction of capacity above which flushing is unthrottled */
+  float flush_dirty_high_;
+  /** Interval (ms) where blobs are checked for re-organization */
   size_t blob_reorg_period_;
   /** Time when score is equal to 1 (seconds) */
   float recency_min_;
@@ -204,6 +216,20 @@ class ServerConfig : public BaseConfig {
       dev.capacity_ =
           hshm::ConfigParse::ParseSize(
               dev_info["capacity"].as<std::string>());
+      dev.bandwidth_ = 0;
+      if (dev_info["bandwidth"]) {
+        dev.bandwidth_ = (f32)hshm::ConfigParse::ParseBandwidth(
+            dev_info["bandwidth"].as<std::string>()) / MEGABYTES(1);
+      }
+      dev.latency_ = 0;
+      if (dev_info["latency"]) {
+        dev.latency_ = (f32)hshm::ConfigParse::ParseLatency(
+            dev_info["latency"].as<std::string>()) / 1000;
+      }
+      dev.compress_ = "none";
+      if (dev_info["compress"]) {
+        dev.compress_ = dev_info["compress"].as<std::string>();
+      }
       std::vector<std::string> size_vec;
       ParseVector<std::string, std::vector<std::string>>(
           dev_info["slab_sizes"], size_vec);
@@ -232,6 +258,22 @@ class ServerConfig : public BaseConfig {
     if (yaml_conf["flush_period"]) {
       borg_.flush_period_ = yaml_conf["flush_period"].as<size_t>();
     }
+    if (yaml_conf["flush_budget"]) {
+      borg_.flush_budget_ = yaml_conf["flush_budget"].as<size_t>();
+    }
+    if (yaml_conf["flush_bandwidth"]) {
+      borg_.flush_bandwidth_ = hshm::ConfigParse::ParseBandwidth(
+          yaml_conf["flush_bandwidth"].as<std::string>());
+    }
+    if (yaml_conf["flush_idle_time"]) {
+      borg_.flush_idle_time_ = yaml_conf["flush_idle_time"].as<size_t>();
+    }
+    if (yaml_conf["flush_dirty_low"]) {
+      borg_.flush_dirty_low_ = yaml_conf["flush_dirty_low"].as<float>();
+    }
+    if (yaml_conf["flush_dirty_high"]) {
+      borg_.flush_dirty_high_ = yaml_conf["flush_dirty_high"].as<float>();
+    }
     if (yaml_conf["blob_reorg_period"]) {
       borg_.blob_reorg_period_ = yaml_conf["blob_reorg_period"].as<size_t>();
     }
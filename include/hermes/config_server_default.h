@@ -49,29 +49,42 @@ const inline char* kHermesServerDefaultConfigStr =
 "    # that the device is always at least 30% occupied.\n"
 "    borg_capacity_thresh: [0.0, 1.0]\n"
 "\n"
+"    # Compress blobs placed on the device with lz4 or zstd, or none. Data that\n"
+"    # looks incompressible is stored raw. Requires HERMES_ENABLE_LZ4/ZSTD.\n"
+"    compress: none\n"
+"\n"
 "  nvme:\n"
 "    mount_point: \"./\"\n"
 "    capacity: 100MB\n"
 "    block_size: 4KB\n"
 "    slab_sizes: [ 4KB, 16KB, 64KB, 1MB ]\n"
+"    bandwidth: 1GBps\n"
+"    latency: 600us\n"
 "    is_shared_device: false\n"
 "    borg_capacity_thresh: [ 0.0, 1.0 ]\n"
+"    compress: none\n"
 "\n"
 "  ssd:\n"
 "    mount_point: \"./\"\n"
 "    capacity: 100MB\n"
 "    block_size: 4KB\n"
 "    slab_sizes: [ 4KB, 16KB, 64KB, 1MB ]\n"
+"    bandwidth: 500MBps\n"
+"    latency: 1200us\n"
 "    is_shared_device: false\n"
 "    borg_capacity_thresh: [ 0.0, 1.0 ]\n"
+"    compress: none\n"
 "\n"
 "  pfs:\n"
 "    mount_point: \"./\"\n"
 "    capacity: 100MB\n"
 "    block_size: 64KB # The stripe size of PFS\n"
 "    slab_sizes: [ 4KB, 16KB, 64KB, 1MB ]\n"
+"    bandwidth: 100MBps\n"
+"    latency: 200ms\n"
 "    is_shared_device: true\n"
 "    borg_capacity_thresh: [ 0.0, 1.0 ]\n"
+"    compress: none\n"
 "\n"
 "### Define properties of the BORG\n"
 "buffer_organizer:\n"
@@ -81,6 +94,21 @@ const inline char* kHermesServerDefaultConfigStr =
 "  # Interval (ms) where blobs are checked for flushing\n"
 "  flush_period: 1024\n"
 "\n"
+"  # Maximum number of dirty blobs flushed per sweep (0 is unlimited)\n"
+"  flush_budget: 4096\n"
+"\n"
+"  # Bandwidth available to flushing (0 is unlimited)\n"
+"  flush_bandwidth: 256MBps\n"
+"\n"
+"  # Time (ms) a target must go without foreground I/O to be considered idle\n"
+"  flush_idle_time: 50\n"
+"\n"
+"  ## How much dirty data is too much? (fraction of buffering capacity)\n"
+"  # Below this, flushing waits for the targets to be idle\n"
+"  flush_dirty_low: 0.1\n"
+"  # Above this, flushing ignores foreground load and the bandwidth limit\n"
+"  flush_dirty_high: 0.5\n"
+"\n"
 "  # Interval (ms) where blobs are checked for re-organization\n"
 "  blob_reorg_period: 1024\n"
 "\n"
@@ -98,7 +126,7 @@ const inline char* kHermesServerDefaultConfigStr =
 "\n"
 "### Define the default data placement policy\n"
 "dpe:\n"
-"  # Choose Random, RoundRobin, or MinimizeIoTime\n"
+"  # Choose Random, RoundRobin, MinimizeIoTime, PowerOfTwo, or DeadlineAware\n"
 "  default_placement_policy: \"MinimizeIoTime\"\n"
 "\n"
 "  # If true (1) the RoundRobin placement policy algorithm will split each Blob\n"
@@ -9,6 +9,15 @@
 
 namespace hermes {
 
+/** A blob (or a byte range of it) to stage out as part of a batch */
+struct StageOutEntry {
+  std::string blob_name_;
+  hipc::Pointer data_p_;
+  size_t data_size_;
+  size_t blob_off_ = 0; /**< Offset of data_p_ within the blob */
+  bool ok_ = true;      /**< Cleared by the stager if the write failed */
+};
+
 class AbstractStager {
  public:
   std::string path_;
@@ -20,12 +29,61 @@ class AbstractStager {
   virtual void RegisterStager(const hipc::MemContext &mctx,
                               const std::string &tag_name,
                               const std::string &params) = 0;
-  virtual void StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+  /**
+   * Stage a blob in. \a task is the runtime task waiting on the I/O.
+   * @return whether the blob was put into hermes
+   * */
+  virtual bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
                        const TagId &tag_id, const std::string &blob_name,
-                       float score) = 0;
-  virtual void StageOut(const hipc::MemContext &mctx, hermes::Client &client,
+                       float score, Task *task) = 0;
+  /**
+   * Stage a blob out. \a task is the runtime task waiting on the I/O.
+   * @return whether the blob reached the backend
+   * */
+  virtual bool StageOut(const hipc::MemContext &mctx, hermes::Client &client,
                         const TagId &tag_id, const std::string &blob_name,
-                        hipc::Pointer &data_p, size_t data_size) = 0;
+                        hipc::Pointer &data_p, size_t data_size,
+                        Task *task) = 0;
+  /** Whether StageOutBatch accepts entries with a nonzero blob_off_ */
+  virtual bool CanStageRanges() { return false; }
+  /**
+   * Stage out a batch of blobs from the same tag. The ok_ flag of each
+   * entry that did not reach the backend is cleared, so the caller keeps
+   * it dirty.
+   * */
+  virtual void StageOutBatch(const hipc::MemContext &mctx,
+                             hermes::Client &client, const TagId &tag_id,
+                             std::vector<StageOutEntry> &entries,
+                             Task *task) {
+    for (StageOutEntry &entry : entries) {
+      entry.ok_ = StageOut(mctx, client, tag_id, entry.blob_name_,
+                           entry.data_p_, entry.data_size_, task);
+    }
+  }
+  /**
+   * Make the data staged out so far durable on the backend.
+   * @return false if the backend could not be synced
+   * */
+  virtual bool Sync(Task *task) { return true; }
+  /** Size of the backend, or 0 if unknown */
+  virtual size_t GetBackendSize() { return 0; }
+  /** Names of the blobs that hold [off, off + size) of the backend */
+  virtual void GetBlobRange(size_t off, size_t size,
+                            std::vector<std::string> &blob_names) {}
+  /**
+   * Stage in a batch of blobs from the same tag.
+   * @return the number of blobs put into hermes
+   * */
+  virtual size_t StageInBatch(const hipc::MemContext &mctx,
+                              hermes::Client &client, const TagId &tag_id,
+                              const std::vector<std::string> &blob_names,
+                              float score, Task *task) {
+    size_t count = 0;
+    for (const std::string &blob_name : blob_names) {
+      count += StageIn(mctx, client, tag_id, blob_name, score, task);
+    }
+    return count;
+  }
   virtual void UpdateSize(const hipc::MemContext &mctx, hermes::Client &client,
                           const TagId &tag_id, const std::string &blob_name,
                           size_t blob_off, size_t data_size) = 0;
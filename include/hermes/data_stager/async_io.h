@@ -0,0 +1,304 @@
+//
+// Asynchronous file I/O for the data stagers
+//
+
+#ifndef HERMES_TASKS_DATA_STAGER_SRC_ASYNC_IO_H_
+#define HERMES_TASKS_DATA_STAGER_SRC_ASYNC_IO_H_
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef HERMES_ENABLE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "hermes/hermes.h"
+
+namespace hermes {
+
+/** A vectored read or write (or an fdatasync) handed to the AsyncIo engine */
+struct AsyncIoRequest {
+  bool is_write_;           /**< Write (pwritev) or read (preadv) */
+  bool is_sync_ = false;    /**< fdatasync fd_ instead of reading or writing */
+  int fd_;                  /**< The file to access */
+  const struct iovec *iov_; /**< Buffers, valid until the I/O completes */
+  int iovcnt_;              /**< Number of buffers */
+  off_t off_;               /**< Offset in the file */
+  ssize_t ret_ = 0;         /**< Bytes transferred, or -errno */
+  std::atomic<bool> done_{false};
+
+  /** Default constructor */
+  AsyncIoRequest() = default;
+
+  /** Emplace constructor */
+  AsyncIoRequest(bool is_write, int fd, const struct iovec *iov, int iovcnt,
+                 off_t off)
+      : is_write_(is_write), fd_(fd), iov_(iov), iovcnt_(iovcnt), off_(off) {}
+
+  /** Copy constructor (for vectors of requests that aren't submitted yet) */
+  AsyncIoRequest(const AsyncIoRequest &other)
+      : is_write_(other.is_write_),
+        is_sync_(other.is_sync_),
+        fd_(other.fd_),
+        iov_(other.iov_),
+        iovcnt_(other.iovcnt_),
+        off_(other.off_),
+        ret_(other.ret_),
+        done_(other.done_.load()) {}
+
+  /** An fdatasync of \a fd */
+  static AsyncIoRequest Sync(int fd) {
+    AsyncIoRequest req(true, fd, nullptr, 0, 0);
+    req.is_sync_ = true;
+    return req;
+  }
+
+  /** Mark the request finished */
+  void Complete(ssize_t ret) {
+    ret_ = ret;
+    done_.store(true, std::memory_order_release);
+  }
+
+  /** Whether the request finished */
+  bool IsComplete() const { return done_.load(std::memory_order_acquire); }
+};
+
+/**
+ * Runs stager I/O off the chimaera workers. A task submits its requests
+ * and yields until they complete, so one worker keeps many stages in
+ * flight instead of blocking in pread/pwrite.
+ * */
+class AsyncIoEngine {
+ public:
+  virtual ~AsyncIoEngine() = default;
+
+  /** Start a batch of requests */
+  virtual void Submit(AsyncIoRequest *reqs, size_t count) = 0;
+
+  /** The node-wide engine. io_uring when available, else a thread pool. */
+  static AsyncIoEngine *Get();
+
+  /**
+   * Submit \a reqs and wait for all of them. \a task yields between
+   * polls so the worker can run other tasks meanwhile.
+   * */
+  static void Run(Task *task, std::vector<AsyncIoRequest> &reqs) {
+    if (reqs.empty()) {
+      return;
+    }
+    Get()->Submit(reqs.data(), reqs.size());
+    for (AsyncIoRequest &req : reqs) {
+      while (!req.IsComplete()) {
+        if (task) {
+          task->Yield();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+  }
+
+  /** Submit a single request and wait for it */
+  static ssize_t Run(Task *task, bool is_write, int fd,
+                     const struct iovec *iov, int iovcnt, off_t off) {
+    std::vector<AsyncIoRequest> reqs;
+    reqs.emplace_back(is_write, fd, iov, iovcnt, off);
+    Run(task, reqs);
+    return reqs[0].ret_;
+  }
+};
+
+/** Runs blocking preadv/pwritev/fdatasync on a pool of threads */
+class ThreadPoolIoEngine : public AsyncIoEngine {
+ public:
+  std::vector<std::thread> threads_;
+  std::deque<AsyncIoRequest *> queue_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+
+ public:
+  /** Start \a num_threads I/O threads */
+  explicit ThreadPoolIoEngine(size_t num_threads = 16) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { Serve(); });
+    }
+  }
+
+  /** Stop the I/O threads */
+  ~ThreadPoolIoEngine() override {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /** Queue a batch of requests */
+  void Submit(AsyncIoRequest *reqs, size_t count) override {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      for (size_t i = 0; i < count; ++i) {
+        queue_.emplace_back(&reqs[i]);
+      }
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  /** Serve requests until stopped */
+  void Serve() {
+    while (true) {
+      AsyncIoRequest *req;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        req = queue_.front();
+        queue_.pop_front();
+      }
+      ssize_t ret;
+      if (req->is_sync_) {
+        ret = HERMES_POSIX_API->fdatasync(req->fd_);
+      } else if (req->is_write_) {
+        ret = HERMES_POSIX_API->pwritev(req->fd_, req->iov_, req->iovcnt_,
+                                        req->off_);
+      } else {
+        ret = HERMES_POSIX_API->preadv(req->fd_, req->iov_, req->iovcnt_,
+                                       req->off_);
+      }
+      req->Complete(ret < 0 ? -errno : ret);
+    }
+  }
+};
+
+#ifdef HERMES_ENABLE_IO_URING
+/**
+ * Submits requests to an io_uring. A reaper thread waits for
+ * completions and marks the requests done.
+ * */
+class UringIoEngine : public AsyncIoEngine {
+ public:
+  struct io_uring ring_;
+  std::mutex sq_lock_; /**< Guards the submission queue */
+  std::thread reaper_;
+  bool ok_ = false;
+
+ public:
+  /** Set up a ring of \a depth entries */
+  explicit UringIoEngine(unsigned depth = 256) {
+    int ret = io_uring_queue_init(depth, &ring_, 0);
+    if (ret < 0) {
+      HELOG(kWarning, "io_uring is unavailable ({}), using the thread pool",
+            ret);
+      return;
+    }
+    ok_ = true;
+    reaper_ = std::thread([this] { Reap(); });
+  }
+
+  /** Stop the reaper and tear down the ring */
+  ~UringIoEngine() override {
+    if (!ok_) {
+      return;
+    }
+    {
+      // A NOP without user data tells the reaper to exit
+      std::lock_guard<std::mutex> lock(sq_lock_);
+      struct io_uring_sqe *sqe = GetSqe();
+      io_uring_prep_nop(sqe);
+      io_uring_sqe_set_data(sqe, nullptr);
+      io_uring_submit(&ring_);
+    }
+    reaper_.join();
+    io_uring_queue_exit(&ring_);
+  }
+
+  /** Whether the ring was set up */
+  bool IsOk() const { return ok_; }
+
+  /** Queue a batch of requests with one submit */
+  void Submit(AsyncIoRequest *reqs, size_t count) override {
+    std::lock_guard<std::mutex> lock(sq_lock_);
+    for (size_t i = 0; i < count; ++i) {
+      AsyncIoRequest &req = reqs[i];
+      struct io_uring_sqe *sqe = GetSqe();
+      if (req.is_sync_) {
+        io_uring_prep_fsync(sqe, req.fd_, IORING_FSYNC_DATASYNC);
+      } else if (req.is_write_) {
+        io_uring_prep_writev(sqe, req.fd_, req.iov_, req.iovcnt_, req.off_);
+      } else {
+        io_uring_prep_readv(sqe, req.fd_, req.iov_, req.iovcnt_, req.off_);
+      }
+      io_uring_sqe_set_data(sqe, &req);
+    }
+    io_uring_submit(&ring_);
+  }
+
+ private:
+  /** Get a free SQE, flushing the queue to the kernel when it is full */
+  struct io_uring_sqe *GetSqe() {
+    struct io_uring_sqe *sqe;
+    while ((sqe = io_uring_get_sqe(&ring_)) == nullptr) {
+      io_uring_submit(&ring_);
+      std::this_thread::yield();
+    }
+    return sqe;
+  }
+
+  /** Complete requests as the kernel finishes them */
+  void Reap() {
+    while (true) {
+      struct io_uring_cqe *cqe;
+      int ret = io_uring_wait_cqe(&ring_, &cqe);
+      if (ret == -EINTR) {
+        continue;
+      }
+      if (ret < 0) {
+        HELOG(kError, "io_uring_wait_cqe failed: {}", ret);
+        return;
+      }
+      auto *req = (AsyncIoRequest *)io_uring_cqe_get_data(cqe);
+      ssize_t res = cqe->res;
+      io_uring_cqe_seen(&ring_, cqe);
+      if (!req) {
+        return;
+      }
+      req->Complete(res);
+    }
+  }
+};
+#endif
+
+inline AsyncIoEngine *AsyncIoEngine::Get() {
+  static std::unique_ptr<AsyncIoEngine> engine = []() {
+    std::unique_ptr<AsyncIoEngine> engine;
+#ifdef HERMES_ENABLE_IO_URING
+    auto uring = std::make_unique<UringIoEngine>();
+    if (uring->IsOk()) {
+      engine = std::move(uring);
+    }
+#endif
+    if (!engine) {
+      engine = std::make_unique<ThreadPoolIoEngine>();
+    }
+    return engine;
+  }();
+  return engine.get();
+}
+
+}  // namespace hermes
+
+#endif  // HERMES_TASKS_DATA_STAGER_SRC_ASYNC_IO_H_
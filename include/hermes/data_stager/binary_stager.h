@@ -5,7 +5,12 @@
 #ifndef HERMES_TASKS_DATA_STAGER_SRC_BINARY_STAGER_H_
 #define HERMES_TASKS_DATA_STAGER_SRC_BINARY_STAGER_H_
 
+#include <climits>
+#include <cstring>
+#include <mutex>
+
 #include "abstract_stager.h"
+#include "async_io.h"
 #include "hermes_adapters/mapper/abstract_mapper.h"
 
 namespace hermes {
@@ -13,15 +18,33 @@ namespace hermes {
 class BinaryFileStager : public AbstractStager {
  public:
   size_t page_size_;
+  size_t stripe_size_;
   std::string path_;
   bitfield32_t flags_;
+  int fd_ = -1;                  /**< Backend file, kept open across I/Os */
+  int direct_fd_ = -1;           /**< Backend file opened with O_DIRECT */
+  bool direct_io_ = false;       /**< Whether to stage with O_DIRECT */
+  std::vector<int> retired_fds_; /**< Fds replaced after an I/O error */
+  std::mutex fd_lock_;           /**< Guards the fds and direct_io_ */
+  /** Offset, size, and memory alignment O_DIRECT requires */
+  static const size_t kDirectIoAlign = 4096;
 
  public:
   /** Default constructor */
   BinaryFileStager() = default;
 
-  /** Destructor */
-  ~BinaryFileStager() {}
+  /** Destructor. Runs once the stager is unregistered and idle. */
+  ~BinaryFileStager() {
+    if (fd_ >= 0) {
+      HERMES_POSIX_API->close(fd_);
+    }
+    if (direct_fd_ >= 0) {
+      HERMES_POSIX_API->close(direct_fd_);
+    }
+    for (int fd : retired_fds_) {
+      HERMES_POSIX_API->close(fd);
+    }
+  }
 
   /** Build context for staging */
   static Context BuildContext(size_t page_size, u32 flags = 0,
@@ -53,14 +76,219 @@ class BinaryFileStager : public AbstractStager {
     srl >> flags_.bits_;
     srl >> page_size_;
     path_ = tag_name;
+    stripe_size_ = GetStripeSize();
+    direct_io_ = flags_.Any(HERMES_STAGE_DIRECT_IO);
+  }
+
+  /** The stripe size of the shared (PFS) tier, used to align write-back */
+  size_t GetStripeSize() {
+    size_t stripe_size = page_size_;
+    for (config::DeviceInfo &dev : HERMES_SERVER_CONF.devices_) {
+      if (dev.is_shared_ && dev.block_size_ > stripe_size) {
+        stripe_size = dev.block_size_;
+      }
+    }
+    return stripe_size ? stripe_size : 1;
+  }
+
+  /** Get the backend fd, opening the file on first use */
+  int GetFd() {
+    std::lock_guard<std::mutex> lock(fd_lock_);
+    if (fd_ < 0) {
+      fd_ = HERMES_POSIX_API->open(path_.c_str(), O_CREAT | O_RDWR, 0666);
+      if (fd_ < 0) {
+        HELOG(kError, "Failed to open file {}", path_);
+      }
+    }
+    return fd_;
+  }
+
+  /** Get the O_DIRECT backend fd, or -1 if staging is buffered */
+  int GetDirectFd() {
+    std::lock_guard<std::mutex> lock(fd_lock_);
+    if (direct_io_ && direct_fd_ < 0) {
+      direct_fd_ = HERMES_POSIX_API->open(path_.c_str(),
+                                          O_CREAT | O_RDWR | O_DIRECT, 0666);
+      if (direct_fd_ < 0) {
+        HELOG(kWarning, "Direct I/O is unsupported for {}, staging buffered",
+              path_);
+        direct_io_ = false;
+      }
+    }
+    return direct_fd_;
+  }
+
+  /**
+   * Stop using \a fd so the next access re-opens the file. The fd is
+   * closed with the stager, since other I/Os may still be using it.
+   * If \a no_direct, the O_DIRECT fd is not re-opened.
+   * */
+  void ReopenFd(int fd, bool no_direct = false) {
+    std::lock_guard<std::mutex> lock(fd_lock_);
+    if (fd < 0) {
+      return;
+    }
+    if (fd_ == fd) {
+      retired_fds_.emplace_back(fd_);
+      fd_ = -1;
+    } else if (direct_fd_ == fd) {
+      retired_fds_.emplace_back(direct_fd_);
+      direct_fd_ = -1;
+      if (no_direct) {
+        HELOG(kWarning, "Direct I/O to {} failed, staging buffered", path_);
+        direct_io_ = false;
+      }
+    }
+  }
+
+  /** An I/O redirected to the O_DIRECT fd */
+  struct DirectIo {
+    const struct iovec *iov_ = nullptr; /**< The caller's buffers */
+    int iovcnt_ = 0;                    /**< Number of caller buffers */
+    size_t size_ = 0;                   /**< Bytes the caller asked for */
+    bool has_bounce_ = false;           /**< Whether bounce_ is allocated */
+    FullPtr<char> bounce_;              /**< Unaligned bounce allocation */
+    struct iovec bounce_iov_;           /**< The aligned bounce buffer */
+  };
+
+  /**
+   * Send \a req to the O_DIRECT fd if its offset and size allow it.
+   * Buffers that aren't aligned go through an aligned bounce buffer from
+   * the data allocator. Reads may round their size up, since O_DIRECT
+   * reads stop at the end of the file. Unaligned writes (e.g., the last
+   * page of a file) stay buffered; the kernel keeps the two coherent.
+   * */
+  void ToDirectIo(const hipc::MemContext &mctx, AsyncIoRequest &req,
+                  int direct_fd, DirectIo &dio) {
+    size_t size = 0;
+    bool aligned = true;
+    for (int i = 0; i < req.iovcnt_; ++i) {
+      size += req.iov_[i].iov_len;
+      aligned &= (uintptr_t)req.iov_[i].iov_base % kDirectIoAlign == 0 &&
+                 req.iov_[i].iov_len % kDirectIoAlign == 0;
+    }
+    if (req.off_ % kDirectIoAlign != 0 ||
+        (req.is_write_ && size % kDirectIoAlign != 0)) {
+      return;
+    }
+    req.fd_ = direct_fd;
+    if (aligned) {
+      return;
+    }
+    size_t bounce_size =
+        (size + kDirectIoAlign - 1) / kDirectIoAlign * kDirectIoAlign;
+    dio.iov_ = req.iov_;
+    dio.iovcnt_ = req.iovcnt_;
+    dio.size_ = size;
+    dio.has_bounce_ = true;
+    dio.bounce_ =
+        CHI_CLIENT->AllocateBuffer(mctx, bounce_size + kDirectIoAlign);
+    uintptr_t base = (uintptr_t)dio.bounce_.ptr_;
+    char *buf = (char *)((base + kDirectIoAlign - 1) / kDirectIoAlign *
+                         kDirectIoAlign);
+    dio.bounce_iov_ = {buf, bounce_size};
+    if (req.is_write_) {
+      for (int i = 0; i < req.iovcnt_; ++i) {
+        memcpy(buf, req.iov_[i].iov_base, req.iov_[i].iov_len);
+        buf += req.iov_[i].iov_len;
+      }
+    }
+    req.iov_ = &dio.bounce_iov_;
+    req.iovcnt_ = 1;
+  }
+
+  /** Copy a bounced read back to the caller and free the bounce buffer */
+  void FromDirectIo(AsyncIoRequest &req, DirectIo &dio) {
+    if (!dio.has_bounce_) {
+      return;
+    }
+    if (req.ret_ > (ssize_t)dio.size_) {
+      req.ret_ = dio.size_;
+    }
+    if (!req.is_write_ && req.ret_ > 0) {
+      char *buf = (char *)dio.bounce_iov_.iov_base;
+      size_t left = req.ret_;
+      for (int i = 0; i < dio.iovcnt_ && left > 0; ++i) {
+        size_t len = std::min(left, dio.iov_[i].iov_len);
+        memcpy(dio.iov_[i].iov_base, buf, len);
+        buf += len;
+        left -= len;
+      }
+    }
+    req.iov_ = dio.iov_;
+    req.iovcnt_ = dio.iovcnt_;
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, dio.bounce_);
+  }
+
+  /** Submit \a reqs to the backend and wait for them */
+  void SubmitIo(const hipc::MemContext &mctx, Task *task,
+                std::vector<AsyncIoRequest> &reqs) {
+    int fd = GetFd();
+    if (fd < 0) {
+      for (AsyncIoRequest &req : reqs) {
+        req.Complete(-EBADF);
+      }
+      return;
+    }
+    int direct_fd = GetDirectFd();
+    std::vector<DirectIo> dios(reqs.size());
+    for (size_t i = 0; i < reqs.size(); ++i) {
+      reqs[i].fd_ = fd;
+      if (direct_fd >= 0) {
+        ToDirectIo(mctx, reqs[i], direct_fd, dios[i]);
+      }
+    }
+    AsyncIoEngine::Run(task, reqs);
+    for (size_t i = 0; i < reqs.size(); ++i) {
+      FromDirectIo(reqs[i], dios[i]);
+    }
+  }
+
+  /**
+   * Run \a reqs on the backend. Failed I/Os are retried once after
+   * re-opening the file, and buffered if O_DIRECT rejected them.
+   * */
+  void RunIo(const hipc::MemContext &mctx, Task *task,
+             std::vector<AsyncIoRequest> &reqs) {
+    SubmitIo(mctx, task, reqs);
+    std::vector<AsyncIoRequest> retries;
+    std::vector<size_t> retry_idxs;
+    for (size_t i = 0; i < reqs.size(); ++i) {
+      AsyncIoRequest &req = reqs[i];
+      if (req.ret_ >= 0) {
+        continue;
+      }
+      ReopenFd(req.fd_, req.ret_ == -EINVAL);
+      retries.emplace_back(req.is_write_, -1, req.iov_, req.iovcnt_,
+                           req.off_);
+      retry_idxs.emplace_back(i);
+    }
+    if (retries.empty()) {
+      return;
+    }
+    HELOG(kWarning, "{} I/Os to {} failed, re-opening the file",
+          retries.size(), path_);
+    SubmitIo(mctx, task, retries);
+    for (size_t i = 0; i < retries.size(); ++i) {
+      reqs[retry_idxs[i]].ret_ = retries[i].ret_;
+    }
+  }
+
+  /** Run a single I/O on the backend */
+  ssize_t RunIo(const hipc::MemContext &mctx, Task *task, bool is_write,
+                const struct iovec *iov, int iovcnt, off_t off) {
+    std::vector<AsyncIoRequest> reqs;
+    reqs.emplace_back(is_write, -1, iov, iovcnt, off);
+    RunIo(mctx, task, reqs);
+    return reqs[0].ret_;
   }
 
   /** Stage data in from remote source */
-  void StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+  bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
                const TagId &tag_id, const std::string &blob_name,
-               float score) override {
+               float score, Task *task) override {
     if (flags_.Any(HERMES_STAGE_NO_READ)) {
-      return;
+      return false;
     }
     // Get the position of the file to stage in
     adapter::BlobPlacement plcmnt;
@@ -70,38 +298,147 @@ class BinaryFileStager : public AbstractStager {
           page_size_, path_, plcmnt.bucket_off_);
     // Stage in the data from the file
     FullPtr<char> blob = CHI_CLIENT->AllocateBuffer(mctx, page_size_);
-    int fd = HERMES_POSIX_API->open(path_.c_str(), O_CREAT | O_RDWR, 0666);
-    if (fd < 0) {
-      HELOG(kError, "Failed to open file {}", path_);
-      CHI_CLIENT->FreeBuffer(HSHM_MCTX, blob);
-      return;
-    }
-    ssize_t real_size = HERMES_POSIX_API->pread(fd, blob.ptr_, page_size_,
-                                                (off_t)plcmnt.bucket_off_);
-    HERMES_POSIX_API->close(fd);
+    struct iovec iov = {blob.ptr_, page_size_};
+    ssize_t real_size =
+        RunIo(mctx, task, false, &iov, 1, (off_t)plcmnt.bucket_off_);
     // Verify the data was staged in
     if (real_size < 0) {
       CHI_CLIENT->FreeBuffer(HSHM_MCTX, blob);
-      return;
+      return false;
     } else if (real_size == 0) {
       CHI_CLIENT->FreeBuffer(HSHM_MCTX, blob);
-      return;
+      return false;
     }
     // Put the new blob into hermes
     HILOG(kDebug, "Staged {} bytes from the backend file {}", real_size, path_);
     hapi::Context ctx;
-    ctx.flags_.SetBits(HERMES_SHOULD_STAGE);
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE | HERMES_DID_STAGE_IN);
     client.PutBlob(mctx, chi::DomainQuery::GetDynamic(), tag_id,
                    chi::string(blob_name), hermes::BlobId::GetNull(), 0,
                    real_size, blob.shm_, score, TASK_DATA_OWNER, 0, ctx);
+    return true;
+  }
+
+  /** The size of the backend file */
+  size_t GetBackendSize() override {
+    int fd = GetFd();
+    struct stat buf;
+    if (fd < 0 || HERMES_POSIX_API->fstat(fd, &buf) < 0) {
+      return 0;
+    }
+    return buf.st_size;
+  }
+
+  /** The pages that hold [off, off + size) of the file */
+  void GetBlobRange(size_t off, size_t size,
+                    std::vector<std::string> &blob_names) override {
+    if (size == 0) {
+      return;
+    }
+    size_t first_page = off / page_size_;
+    size_t last_page = (off + size + page_size_ - 1) / page_size_;
+    blob_names.reserve(blob_names.size() + last_page - first_page);
+    for (size_t page = first_page; page < last_page; ++page) {
+      blob_names.emplace_back(
+          adapter::BlobPlacement::CreateBlobName(page).str());
+    }
+  }
+
+  /**
+   * Stage in a batch of pages. Adjacent pages are read with one preadv
+   * and all reads are submitted together, so the backend sees a few
+   * large requests instead of one small read per page. Returns the
+   * number of pages put into hermes.
+   * */
+  size_t StageInBatch(const hipc::MemContext &mctx, hermes::Client &client,
+                      const TagId &tag_id,
+                      const std::vector<std::string> &blob_names, float score,
+                      Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_READ) || blob_names.empty()) {
+      return 0;
+    }
+    // Order the pages by their position in the file
+    std::vector<std::pair<size_t, const std::string *>> pages;
+    pages.reserve(blob_names.size());
+    for (const std::string &blob_name : blob_names) {
+      adapter::BlobPlacement plcmnt;
+      plcmnt.DecodeBlobName(blob_name, page_size_);
+      pages.emplace_back(plcmnt.bucket_off_, &blob_name);
+    }
+    std::sort(pages.begin(), pages.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    // Merge adjacent pages into runs
+    std::vector<FullPtr<char>> blobs;
+    std::vector<PageRun> runs;
+    blobs.reserve(pages.size());
+    for (auto &page : pages) {
+      if (runs.empty() || runs.back().iov_.size() >= IOV_MAX ||
+          page.first != runs.back().off_ + runs.back().size_ ||
+          (runs.back().size_ >= stripe_size_ &&
+           page.first % stripe_size_ == 0)) {
+        runs.emplace_back();
+        runs.back().off_ = page.first;
+      }
+      PageRun &run = runs.back();
+      blobs.emplace_back(CHI_CLIENT->AllocateBuffer(mctx, page_size_));
+      run.iov_.push_back({blobs.back().ptr_, page_size_});
+      run.size_ += page_size_;
+    }
+    // Stage in the data from the file
+    std::vector<AsyncIoRequest> reqs;
+    reqs.reserve(runs.size());
+    for (PageRun &run : runs) {
+      reqs.emplace_back(false, -1, run.iov_.data(), (int)run.iov_.size(),
+                        (off_t)run.off_);
+    }
+    RunIo(mctx, task, reqs);
+    // Put the pages that were read into hermes
+    hapi::Context ctx;
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE | HERMES_DID_STAGE_IN);
+    std::vector<FullPtr<PutBlobTask>> put_tasks;
+    put_tasks.reserve(pages.size());
+    size_t page_idx = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      PageRun &run = runs[i];
+      ssize_t real_size = reqs[i].ret_;
+      if (real_size < 0) {
+        HELOG(kError, "Failed to stage in {} bytes at offset {} of {}",
+              run.size_, run.off_, path_);
+        real_size = 0;
+      }
+      HILOG(kDebug, "Staged {} bytes in {} pages from the backend file {}",
+            real_size, run.iov_.size(), path_);
+      for (size_t j = 0; j < run.iov_.size(); ++j, ++page_idx) {
+        FullPtr<char> &blob = blobs[page_idx];
+        size_t page_off = j * page_size_;
+        if ((size_t)real_size <= page_off) {
+          CHI_CLIENT->FreeBuffer(HSHM_MCTX, blob);
+          continue;
+        }
+        size_t blob_size = std::min(page_size_, (size_t)real_size - page_off);
+        put_tasks.emplace_back(client.AsyncPutBlob(
+            mctx, chi::DomainQuery::GetDynamic(), tag_id,
+            chi::string(*pages[page_idx].second), hermes::BlobId::GetNull(),
+            0, blob_size, blob.shm_, score, TASK_DATA_OWNER, 0, ctx));
+      }
+    }
+    if (task) {
+      task->Wait(put_tasks);
+    }
+    for (FullPtr<PutBlobTask> &put_task : put_tasks) {
+      put_task->Wait();
+      CHI_CLIENT->DelTask(mctx, put_task);
+    }
+    return put_tasks.size();
   }
 
   /** Stage data out to remote source */
-  void StageOut(const hipc::MemContext &mctx, hermes::Client &client,
+  bool StageOut(const hipc::MemContext &mctx, hermes::Client &client,
                 const TagId &tag_id, const std::string &blob_name,
-                hipc::Pointer &data_p, size_t data_size) override {
+                hipc::Pointer &data_p, size_t data_size,
+                Task *task) override {
     if (flags_.Any(HERMES_STAGE_NO_WRITE)) {
-      return;
+      return true;
     }
     // Get the position of the file to stage out
     adapter::BlobPlacement plcmnt;
@@ -111,20 +448,117 @@ class BinaryFileStager : public AbstractStager {
           page_size_, path_, plcmnt.bucket_off_);
     // Stage out the data to the file
     char *data = CHI_CLIENT->GetDataPointer(data_p);
-    int fd = HERMES_POSIX_API->open(path_.c_str(), O_CREAT | O_RDWR, 0666);
-    if (fd < 0) {
-      HELOG(kError, "Failed to open file {}", path_);
-      return;
-    }
-    ssize_t real_size = HERMES_POSIX_API->pwrite(fd, data, data_size,
-                                                 (off_t)plcmnt.bucket_off_);
-    HERMES_POSIX_API->close(fd);
+    struct iovec iov = {data, data_size};
+    ssize_t real_size =
+        RunIo(mctx, task, true, &iov, 1, (off_t)plcmnt.bucket_off_);
     // Verify the data was staged out
-    if (real_size < 0) {
+    if (real_size < 0 || (size_t)real_size != data_size) {
       HELOG(kError, "Failed to stage out {} bytes from {}", data_size, path_);
+      return false;
     }
     HILOG(kDebug, "Staged out {} bytes to the backend file {}", real_size,
           path_);
+    return true;
+  }
+
+  /** Partial pages are written at their offset in the file */
+  bool CanStageRanges() override { return true; }
+
+  /** Contiguous pages written with one pwritev */
+  struct PageRun {
+    size_t off_ = 0;
+    size_t size_ = 0;
+    std::vector<struct iovec> iov_;
+  };
+
+  /**
+   * Stage out a batch of pages. Pages are sorted by file offset and
+   * adjacent pages are merged into one pwritev. A merged write ends at a
+   * stripe boundary once it spans a stripe, so later writes start aligned.
+   * All writes are submitted together to keep the backend's queue deep.
+   * */
+  void StageOutBatch(const hipc::MemContext &mctx, hermes::Client &client,
+                     const TagId &tag_id,
+                     std::vector<StageOutEntry> &entries,
+                     Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_WRITE) || entries.empty()) {
+      return;
+    }
+    // Order the pages by their position in the file
+    std::vector<std::pair<size_t, StageOutEntry *>> pages;
+    pages.reserve(entries.size());
+    for (StageOutEntry &entry : entries) {
+      adapter::BlobPlacement plcmnt;
+      plcmnt.DecodeBlobName(entry.blob_name_, page_size_);
+      pages.emplace_back(plcmnt.bucket_off_ + entry.blob_off_, &entry);
+    }
+    std::sort(pages.begin(), pages.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    // Merge adjacent pages into runs
+    std::vector<PageRun> runs;
+    for (auto &page : pages) {
+      StageOutEntry &entry = *page.second;
+      if (runs.empty() || runs.back().iov_.size() >= IOV_MAX ||
+          page.first != runs.back().off_ + runs.back().size_ ||
+          (runs.back().size_ >= stripe_size_ &&
+           page.first % stripe_size_ == 0)) {
+        runs.emplace_back();
+        runs.back().off_ = page.first;
+      }
+      PageRun &run = runs.back();
+      run.iov_.push_back({CHI_CLIENT->GetDataPointer(entry.data_p_),
+                          entry.data_size_});
+      run.size_ += entry.data_size_;
+    }
+    // Stage out the data to the file
+    std::vector<AsyncIoRequest> reqs;
+    reqs.reserve(runs.size());
+    for (PageRun &run : runs) {
+      reqs.emplace_back(true, -1, run.iov_.data(), (int)run.iov_.size(),
+                        (off_t)run.off_);
+    }
+    RunIo(mctx, task, reqs);
+    size_t page_idx = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      PageRun &run = runs[i];
+      ssize_t real_size = reqs[i].ret_;
+      bool ok = real_size >= 0 && (size_t)real_size == run.size_;
+      if (!ok) {
+        HELOG(kError, "Failed to stage out {} bytes at offset {} of {}",
+              run.size_, run.off_, path_);
+      }
+      for (size_t j = 0; j < run.iov_.size(); ++j, ++page_idx) {
+        pages[page_idx].second->ok_ = ok;
+      }
+      HILOG(kDebug, "Staged out {} bytes in {} pages to the backend file {}",
+            real_size, run.iov_.size(), path_);
+    }
+  }
+
+  /** fdatasync the backend file through each fd it was written with */
+  bool Sync(Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_WRITE)) {
+      return true;
+    }
+    std::vector<AsyncIoRequest> reqs;
+    {
+      std::lock_guard<std::mutex> lock(fd_lock_);
+      if (fd_ >= 0) {
+        reqs.emplace_back(AsyncIoRequest::Sync(fd_));
+      }
+      if (direct_fd_ >= 0) {
+        reqs.emplace_back(AsyncIoRequest::Sync(direct_fd_));
+      }
+    }
+    AsyncIoEngine::Run(task, reqs);
+    bool ok = true;
+    for (AsyncIoRequest &req : reqs) {
+      if (req.ret_ < 0) {
+        HELOG(kError, "Failed to sync {}: {}", path_, strerror(-req.ret_));
+        ok = false;
+      }
+    }
+    return ok;
   }
 
   void UpdateSize(const hipc::MemContext &mctx, hermes::Client &client,
@@ -0,0 +1,268 @@
+//
+// Stages node-local files in through a memory mapping
+//
+
+#ifndef HERMES_TASKS_DATA_STAGER_SRC_MMAP_STAGER_H_
+#define HERMES_TASKS_DATA_STAGER_SRC_MMAP_STAGER_H_
+
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#include <mutex>
+
+#include "binary_stager.h"
+
+namespace hermes {
+
+/**
+ * A file stager for inputs on node-local storage. The file is mapped
+ * once and pages are copied into hermes straight from the mapping, so
+ * staging in needs no read syscalls. Each page is still copied into a
+ * newly allocated blob buffer. Pages past the end of the mapping (e.g.,
+ * the file grew) or past the current end of the file (it was truncated)
+ * and all stage-outs use the regular file I/O of BinaryFileStager. A page
+ * truncated away while it is being copied raises SIGBUS, which is caught
+ * and the page is read with file I/O instead.
+ * */
+class MmapFileStager : public BinaryFileStager {
+ public:
+  char *map_ = nullptr;   /**< The read-only mapping of the file */
+  size_t map_size_ = 0;   /**< Bytes mapped */
+  bool map_failed_ = false; /**< mmap failed, so use file I/O */
+  std::mutex map_lock_;   /**< Guards the mapping */
+
+ public:
+  /** Default constructor */
+  MmapFileStager() = default;
+
+  /** Destructor. Runs once the stager is unregistered and idle. */
+  ~MmapFileStager() {
+    if (map_) {
+      munmap(map_, map_size_);
+    }
+  }
+
+  /** Build context for staging */
+  static Context BuildContext(size_t page_size, u32 flags = 0,
+                              size_t elmt_size = 1) {
+    Context ctx;
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE);
+    ctx.bkt_params_ = BuildFileParams(page_size, flags, elmt_size);
+    return ctx;
+  }
+
+  /** Build serialized file parameter pack */
+  static std::string BuildFileParams(size_t page_size, u32 flags = 0,
+                                     size_t elmt_size = 1) {
+    chi::string params(32);
+    page_size = (page_size / elmt_size) * elmt_size;
+    hipc::LocalSerialize srl(params);
+    srl << std::string("mmap");
+    srl << flags;
+    srl << page_size;
+    return params.str();
+  }
+
+  /**
+   * Map the file on first use. An empty file is mapped once it has data.
+   * The file is re-stat'd on every call: touching a mapped page past the
+   * end of the file raises SIGBUS, so only the part of the mapping the
+   * file still backs is usable. The mapping itself is kept, since other
+   * stage-ins may be copying from it.
+   *
+   * @return the number of bytes at \a map that are safe to read
+   * */
+  size_t GetMapping(char *&map) {
+    int fd = GetFd();
+    size_t size = GetBackendSize();
+    std::lock_guard<std::mutex> lock(map_lock_);
+    if (!map_ && !map_failed_) {
+      if (fd >= 0 && size > 0) {
+        void *ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) {
+          HELOG(kWarning, "Failed to map {}, staging with file I/O", path_);
+          map_failed_ = true;
+        } else {
+          map_ = (char *)ptr;
+          map_size_ = size;
+          madvise(map_, map_size_, MADV_SEQUENTIAL);
+        }
+      }
+    }
+    map = map_;
+    if (size < map_size_) {
+      HILOG(kDebug, "{} shrank to {} of {} mapped bytes", path_, size,
+            map_size_);
+      return size;
+    }
+    return map_size_;
+  }
+
+  /** Whether the page at \a off is entirely within the mapping */
+  static bool IsMapped(char *map, size_t map_size, size_t off,
+                       size_t page_size) {
+    return map && off + page_size <= map_size;
+  }
+
+  /** Where a SIGBUS during CopyMapped on this thread jumps to */
+  static sigjmp_buf *&GetCopyEnv() {
+    static thread_local sigjmp_buf *env = nullptr;
+    return env;
+  }
+
+  /** The SIGBUS action that was installed before ours */
+  static struct sigaction &GetPrevAction() {
+    static struct sigaction prev;
+    return prev;
+  }
+
+  /**
+   * SIGBUS handler. A fault inside CopyMapped jumps back to it. Any other
+   * fault restores the previous action, so re-running the faulting
+   * instruction raises it there.
+   * */
+  static void OnSigbus(int sig, siginfo_t *info, void *uctx) {
+    sigjmp_buf *env = GetCopyEnv();
+    if (env) {
+      siglongjmp(*env, 1);
+    }
+    sigaction(SIGBUS, &GetPrevAction(), nullptr);
+  }
+
+  /** Install OnSigbus once per process */
+  static void InstallSigbusHandler() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+      struct sigaction action = {};
+      action.sa_sigaction = OnSigbus;
+      action.sa_flags = SA_SIGINFO;
+      sigemptyset(&action.sa_mask);
+      sigaction(SIGBUS, &action, &GetPrevAction());
+    });
+  }
+
+  /**
+   * Copy from the mapping. The file may be truncated between GetMapping
+   * and the copy, so a SIGBUS is caught instead of crashing the runtime.
+   *
+   * @return false if part of \a src is no longer backed by the file
+   * */
+  static bool CopyMapped(char *dst, const char *src, size_t size) {
+    InstallSigbusHandler();
+    sigjmp_buf env;
+    if (sigsetjmp(env, 1)) {
+      GetCopyEnv() = nullptr;
+      return false;
+    }
+    GetCopyEnv() = &env;
+    memcpy(dst, src, size);
+    GetCopyEnv() = nullptr;
+    return true;
+  }
+
+  /**
+   * Copy a page from the mapping into a new blob.
+   * @return false if the page was truncated away during the copy
+   * */
+  bool AsyncPutMapped(const hipc::MemContext &mctx, hermes::Client &client,
+                      const TagId &tag_id, const std::string &blob_name,
+                      const char *page, float score,
+                      FullPtr<PutBlobTask> &put_task) {
+    FullPtr<char> blob = CHI_CLIENT->AllocateBuffer(mctx, page_size_);
+    if (!CopyMapped(blob.ptr_, page, page_size_)) {
+      HILOG(kDebug, "{} was truncated while staging {} in", path_, blob_name);
+      CHI_CLIENT->FreeBuffer(mctx, blob);
+      return false;
+    }
+    hapi::Context ctx;
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE | HERMES_DID_STAGE_IN);
+    put_task = client.AsyncPutBlob(mctx, chi::DomainQuery::GetDynamic(),
+                                   tag_id, chi::string(blob_name),
+                                   hermes::BlobId::GetNull(), 0, page_size_,
+                                   blob.shm_, score, TASK_DATA_OWNER, 0, ctx);
+    return true;
+  }
+
+  /** Stage a page in from the mapping */
+  bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+               const TagId &tag_id, const std::string &blob_name,
+               float score, Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_READ)) {
+      return false;
+    }
+    adapter::BlobPlacement plcmnt;
+    plcmnt.DecodeBlobName(blob_name, page_size_);
+    char *map;
+    size_t map_size = GetMapping(map);
+    FullPtr<PutBlobTask> put_task;
+    if (!IsMapped(map, map_size, plcmnt.bucket_off_, page_size_) ||
+        !AsyncPutMapped(mctx, client, tag_id, blob_name,
+                        map + plcmnt.bucket_off_, score, put_task)) {
+      return BinaryFileStager::StageIn(mctx, client, tag_id, blob_name, score,
+                                       task);
+    }
+    put_task->Wait();
+    CHI_CLIENT->DelTask(mctx, put_task);
+    return true;
+  }
+
+  /**
+   * Stage in a batch of pages from the mapping. The kernel is asked to
+   * read the batch ahead before the pages are copied.
+   * */
+  size_t StageInBatch(const hipc::MemContext &mctx, hermes::Client &client,
+                      const TagId &tag_id,
+                      const std::vector<std::string> &blob_names, float score,
+                      Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_READ) || blob_names.empty()) {
+      return 0;
+    }
+    char *map;
+    size_t map_size = GetMapping(map);
+    std::vector<std::pair<size_t, const std::string *>> mapped;
+    std::vector<std::string> unmapped;
+    size_t min_off = SIZE_MAX, max_off = 0, put_count = 0;
+    for (const std::string &blob_name : blob_names) {
+      adapter::BlobPlacement plcmnt;
+      plcmnt.DecodeBlobName(blob_name, page_size_);
+      if (!IsMapped(map, map_size, plcmnt.bucket_off_, page_size_)) {
+        unmapped.emplace_back(blob_name);
+        continue;
+      }
+      mapped.emplace_back(plcmnt.bucket_off_, &blob_name);
+      min_off = std::min(min_off, plcmnt.bucket_off_);
+      max_off = std::max(max_off, plcmnt.bucket_off_ + page_size_);
+    }
+    if (!mapped.empty()) {
+      size_t sys_page = (size_t)sysconf(_SC_PAGESIZE);
+      min_off = min_off / sys_page * sys_page;
+      madvise(map + min_off, max_off - min_off, MADV_WILLNEED);
+      std::vector<FullPtr<PutBlobTask>> put_tasks;
+      put_tasks.reserve(mapped.size());
+      for (auto &page : mapped) {
+        FullPtr<PutBlobTask> put_task;
+        if (AsyncPutMapped(mctx, client, tag_id, *page.second,
+                           map + page.first, score, put_task)) {
+          put_tasks.emplace_back(put_task);
+        } else {
+          unmapped.emplace_back(*page.second);
+        }
+      }
+      if (task) {
+        task->Wait(put_tasks);
+      }
+      for (FullPtr<PutBlobTask> &put_task : put_tasks) {
+        put_task->Wait();
+        CHI_CLIENT->DelTask(mctx, put_task);
+      }
+      put_count = put_tasks.size();
+    }
+    return put_count + BinaryFileStager::StageInBatch(mctx, client, tag_id,
+                                                      unmapped, score, task);
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_TASKS_DATA_STAGER_SRC_MMAP_STAGER_H_
@@ -75,11 +75,11 @@ class NvidiaGdsStager : public AbstractStager {
   }
 
   /** Stage data in from a remote source */
-  void StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+  bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
                const TagId &tag_id, const std::string &blob_name,
-               float score) override {
+               float score, Task *task) override {
     if (flags_.Any(HERMES_STAGE_NO_READ)) {
-      return;
+      return false;
     }
 
     adapter::BlobPlacement plcmnt;
@@ -90,7 +90,7 @@ class NvidiaGdsStager : public AbstractStager {
     if (err != cudaSuccess) {
       HELOG(kError, "Failed to allocate GPU memory: {}",
             cudaGetErrorString(err));
-      return;
+      return false;
     }
 
     ssize_t real_size =
@@ -98,16 +98,19 @@ class NvidiaGdsStager : public AbstractStager {
     if (real_size < 0) {
       HELOG(kError, "Failed to read data using cuFile from: {}", path_);
       cudaFree(gpu_ptr);
-      return;
+      return false;
     }
+    // The data stays on the GPU; no blob is put into hermes
+    return false;
   }
 
   /** Stage data out to a remote source */
-  void StageOut(const hipc::MemContext &mctx, hermes::Client &client,
+  bool StageOut(const hipc::MemContext &mctx, hermes::Client &client,
                 const TagId &tag_id, const std::string &blob_name,
-                hipc::Pointer &data_p, size_t data_size) override {
+                hipc::Pointer &data_p, size_t data_size,
+                Task *task) override {
     if (flags_.Any(HERMES_STAGE_NO_WRITE)) {
-      return;
+      return true;
     }
 
     adapter::BlobPlacement plcmnt;
@@ -118,7 +121,7 @@ class NvidiaGdsStager : public AbstractStager {
     if (err != cudaSuccess) {
       HELOG(kError, "Failed to allocate GPU memory: {}",
             cudaGetErrorString(err));
-      return;
+      return false;
     }
 
     ssize_t real_size =
@@ -126,8 +129,9 @@ class NvidiaGdsStager : public AbstractStager {
     cudaFree(gpu_ptr);
     if (real_size < 0) {
       HELOG(kError, "Failed to write data using cuFile to: {}", path_);
-      return;
+      return false;
     }
+    return true;
   }
 
   /** Update metadata size */
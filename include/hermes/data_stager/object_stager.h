@@ -0,0 +1,342 @@
+//
+// Stages pages of an object in an object store
+//
+
+#ifndef HERMES_TASKS_DATA_STAGER_SRC_OBJECT_STAGER_H_
+#define HERMES_TASKS_DATA_STAGER_SRC_OBJECT_STAGER_H_
+
+#include <climits>
+
+#include "abstract_stager.h"
+#include "hermes_adapters/mapper/abstract_mapper.h"
+#include "object_transport.h"
+
+namespace hermes {
+
+/**
+ * Stages a tag to an object in an object store. Each page is a byte
+ * range of the object named by the tag. Adjacent pages are read with
+ * one ranged GET and written as one part of a multipart upload, and all
+ * requests of a batch are in flight together.
+ * */
+class ObjectStager : public AbstractStager {
+ public:
+  size_t page_size_;
+  size_t part_size_; /**< Largest ranged GET or upload part */
+  bitfield32_t flags_;
+  std::string uri_; /**< The object store */
+  std::unique_ptr<ObjectTransport> transport_;
+
+ public:
+  /** Default constructor */
+  ObjectStager() = default;
+
+  /** Build context for staging to the object store at \a uri */
+  static Context BuildContext(const std::string &uri, size_t page_size,
+                              u32 flags = 0,
+                              size_t part_size = MEGABYTES(8)) {
+    Context ctx;
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE);
+    ctx.bkt_params_ = BuildObjectParams(uri, page_size, flags, part_size);
+    return ctx;
+  }
+
+  /** Build serialized object parameter pack */
+  static std::string BuildObjectParams(const std::string &uri,
+                                       size_t page_size, u32 flags = 0,
+                                       size_t part_size = MEGABYTES(8)) {
+    chi::string params(32);
+    hipc::LocalSerialize srl(params);
+    srl << std::string("object");
+    srl << flags;
+    srl << page_size;
+    srl << uri;
+    srl << part_size;
+    return params.str();
+  }
+
+  /** Create the data stager payload */
+  void RegisterStager(const hipc::MemContext &mctx, const std::string &tag_name,
+                      const std::string &params) override {
+    std::string protocol;
+    hipc::LocalDeserialize srl(params);
+    srl >> protocol;
+    srl >> flags_.bits_;
+    srl >> page_size_;
+    srl >> uri_;
+    srl >> part_size_;
+    path_ = tag_name;
+    part_size_ = std::max(part_size_, page_size_);
+    transport_ = ObjectTransport::Create(uri_);
+    if (!transport_) {
+      HELOG(kError, "Unknown object store {} for {}", uri_, path_);
+    } else if (part_size_ < transport_->GetMinPartSize()) {
+      // Otherwise every full run would be too short to be a part
+      part_size_ = transport_->GetMinPartSize();
+    }
+  }
+
+  /** Contiguous pages moved with one request */
+  struct PageRun {
+    size_t off_ = 0;
+    size_t size_ = 0;
+    std::vector<struct iovec> iov_;
+  };
+
+  /** Whether a run at \a off can take \a size more bytes */
+  bool CanExtend(const std::vector<PageRun> &runs, size_t off,
+                 size_t size) const {
+    if (runs.empty()) {
+      return false;
+    }
+    const PageRun &run = runs.back();
+    return off == run.off_ + run.size_ && run.size_ + size <= part_size_ &&
+           run.iov_.size() < IOV_MAX;
+  }
+
+  /** Stage a page in from the object */
+  bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+               const TagId &tag_id, const std::string &blob_name,
+               float score, Task *task) override {
+    return StageInBatch(mctx, client, tag_id, {blob_name}, score, task) > 0;
+  }
+
+  /** Stage in a batch of pages with parallel ranged GETs */
+  size_t StageInBatch(const hipc::MemContext &mctx, hermes::Client &client,
+                      const TagId &tag_id,
+                      const std::vector<std::string> &blob_names, float score,
+                      Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_READ) || blob_names.empty() ||
+        !transport_) {
+      return 0;
+    }
+    // Order the pages by their position in the object
+    std::vector<std::pair<size_t, const std::string *>> pages;
+    pages.reserve(blob_names.size());
+    for (const std::string &blob_name : blob_names) {
+      adapter::BlobPlacement plcmnt;
+      plcmnt.DecodeBlobName(blob_name, page_size_);
+      pages.emplace_back(plcmnt.bucket_off_, &blob_name);
+    }
+    std::sort(pages.begin(), pages.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    // Merge adjacent pages into ranged GETs
+    std::vector<FullPtr<char>> blobs;
+    std::vector<PageRun> runs;
+    blobs.reserve(pages.size());
+    for (auto &page : pages) {
+      if (!CanExtend(runs, page.first, page_size_)) {
+        runs.emplace_back();
+        runs.back().off_ = page.first;
+      }
+      PageRun &run = runs.back();
+      blobs.emplace_back(CHI_CLIENT->AllocateBuffer(mctx, page_size_));
+      run.iov_.push_back({blobs.back().ptr_, page_size_});
+      run.size_ += page_size_;
+    }
+    std::vector<ssize_t> sizes(runs.size(), -1);
+    std::vector<ObjectRequest> reqs;
+    reqs.reserve(runs.size());
+    for (size_t i = 0; i < runs.size(); ++i) {
+      reqs.emplace_back([this, &runs, &sizes, i] {
+        PageRun &run = runs[i];
+        sizes[i] = transport_->GetRange(path_, run.off_, run.iov_.data(),
+                                        (int)run.iov_.size());
+        return sizes[i] >= 0;
+      });
+    }
+    ObjectRequestPool::Run(task, reqs);
+    // Put the pages that were read into hermes
+    hapi::Context ctx;
+    ctx.flags_.SetBits(HERMES_SHOULD_STAGE | HERMES_DID_STAGE_IN);
+    std::vector<FullPtr<PutBlobTask>> put_tasks;
+    put_tasks.reserve(pages.size());
+    size_t page_idx = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+      PageRun &run = runs[i];
+      ssize_t real_size = sizes[i];
+      if (real_size < 0) {
+        HELOG(kError, "Failed to stage in {} bytes at offset {} of {}",
+              run.size_, run.off_, path_);
+        real_size = 0;
+      }
+      HILOG(kDebug, "Staged {} bytes in {} pages from the object {}",
+            real_size, run.iov_.size(), path_);
+      for (size_t j = 0; j < run.iov_.size(); ++j, ++page_idx) {
+        FullPtr<char> &blob = blobs[page_idx];
+        size_t page_off = j * page_size_;
+        if ((size_t)real_size <= page_off) {
+          CHI_CLIENT->FreeBuffer(HSHM_MCTX, blob);
+          continue;
+        }
+        size_t blob_size = std::min(page_size_, (size_t)real_size - page_off);
+        put_tasks.emplace_back(client.AsyncPutBlob(
+            mctx, chi::DomainQuery::GetDynamic(), tag_id,
+            chi::string(*pages[page_idx].second), hermes::BlobId::GetNull(),
+            0, blob_size, blob.shm_, score, TASK_DATA_OWNER, 0, ctx));
+      }
+    }
+    if (task) {
+      task->Wait(put_tasks);
+    }
+    for (FullPtr<PutBlobTask> &put_task : put_tasks) {
+      put_task->Wait();
+      CHI_CLIENT->DelTask(mctx, put_task);
+    }
+    return put_tasks.size();
+  }
+
+  /** Stage a page out to the object */
+  bool StageOut(const hipc::MemContext &mctx, hermes::Client &client,
+                const TagId &tag_id, const std::string &blob_name,
+                hipc::Pointer &data_p, size_t data_size,
+                Task *task) override {
+    std::vector<StageOutEntry> entries(1);
+    entries[0].blob_name_ = blob_name;
+    entries[0].data_p_ = data_p;
+    entries[0].data_size_ = data_size;
+    StageOutBatch(mctx, client, tag_id, entries, task);
+    return entries[0].ok_;
+  }
+
+  bool CanStageRanges() override { return true; }
+
+  /**
+   * Upload runs [first, last) as the parts of one multipart upload and
+   * apply them together.
+   * */
+  bool Upload(Task *task, std::vector<PageRun> &runs, size_t first,
+              size_t last) {
+    std::string upload_id = transport_->CreateUpload(path_);
+    if (upload_id.empty()) {
+      return false;
+    }
+    std::vector<ObjectRequest> reqs;
+    reqs.reserve(last - first);
+    for (size_t i = first; i < last; ++i) {
+      reqs.emplace_back([this, &runs, &upload_id, first, i] {
+        PageRun &run = runs[i];
+        return transport_->UploadPart(path_, upload_id, (int)(i - first) + 1,
+                                      run.off_, run.iov_.data(),
+                                      (int)run.iov_.size());
+      });
+    }
+    if (!ObjectRequestPool::Run(task, reqs)) {
+      transport_->AbortUpload(path_, upload_id);
+      return false;
+    }
+    std::vector<ObjectRequest> complete;
+    complete.emplace_back([this, &upload_id] {
+      return transport_->CompleteUpload(path_, upload_id);
+    });
+    return ObjectRequestPool::Run(task, complete);
+  }
+
+  /**
+   * Stage out a batch of dirty pages as multipart uploads. Adjacent
+   * pages become one part, and the parts upload in parallel. A store
+   * with a minimum part size (e.g., 5 MiB for S3) only accepts a short
+   * part as the last part of an upload, so a run shorter than that ends
+   * its upload and the next run starts a new one. Pages of an upload
+   * that failed have their ok_ cleared.
+   * */
+  void StageOutBatch(const hipc::MemContext &mctx, hermes::Client &client,
+                     const TagId &tag_id,
+                     std::vector<StageOutEntry> &entries,
+                     Task *task) override {
+    if (flags_.Any(HERMES_STAGE_NO_WRITE) || entries.empty()) {
+      return;
+    }
+    if (!transport_) {
+      for (StageOutEntry &entry : entries) {
+        entry.ok_ = false;
+      }
+      return;
+    }
+    // Order the pages by their position in the object
+    std::vector<std::pair<size_t, StageOutEntry *>> pages;
+    pages.reserve(entries.size());
+    for (StageOutEntry &entry : entries) {
+      adapter::BlobPlacement plcmnt;
+      plcmnt.DecodeBlobName(entry.blob_name_, page_size_);
+      pages.emplace_back(plcmnt.bucket_off_ + entry.blob_off_, &entry);
+    }
+    std::sort(pages.begin(), pages.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    // Merge adjacent pages into parts
+    std::vector<PageRun> runs;
+    for (auto &page : pages) {
+      StageOutEntry &entry = *page.second;
+      if (!CanExtend(runs, page.first, entry.data_size_)) {
+        runs.emplace_back();
+        runs.back().off_ = page.first;
+      }
+      PageRun &run = runs.back();
+      run.iov_.push_back({CHI_CLIENT->GetDataPointer(entry.data_p_),
+                          entry.data_size_});
+      run.size_ += entry.data_size_;
+    }
+    // Upload the parts, splitting uploads after short parts
+    size_t min_part = transport_->GetMinPartSize();
+    size_t first = 0, page_idx = 0;
+    while (first < runs.size()) {
+      size_t last = first + 1;
+      while (last < runs.size() && runs[last - 1].size_ >= min_part) {
+        ++last;
+      }
+      bool ok = Upload(task, runs, first, last);
+      size_t size = 0, num_pages = 0;
+      for (size_t i = first; i < last; ++i) {
+        size += runs[i].size_;
+        num_pages += runs[i].iov_.size();
+      }
+      if (ok) {
+        HILOG(kDebug, "Staged out {} bytes in {} parts to the object {}",
+              size, last - first, path_);
+      } else {
+        HELOG(kError, "Failed to stage out {} bytes to {}", size, path_);
+      }
+      for (size_t j = 0; j < num_pages; ++j, ++page_idx) {
+        pages[page_idx].second->ok_ = ok;
+      }
+      first = last;
+    }
+  }
+
+  /** The size of the object */
+  size_t GetBackendSize() override {
+    if (!transport_) {
+      return 0;
+    }
+    return transport_->GetSize(path_);
+  }
+
+  /** The pages that hold [off, off + size) of the object */
+  void GetBlobRange(size_t off, size_t size,
+                    std::vector<std::string> &blob_names) override {
+    if (size == 0) {
+      return;
+    }
+    size_t first_page = off / page_size_;
+    size_t last_page = (off + size + page_size_ - 1) / page_size_;
+    blob_names.reserve(blob_names.size() + last_page - first_page);
+    for (size_t page = first_page; page < last_page; ++page) {
+      blob_names.emplace_back(
+          adapter::BlobPlacement::CreateBlobName(page).str());
+    }
+  }
+
+  void UpdateSize(const hipc::MemContext &mctx, hermes::Client &client,
+                  const TagId &tag_id, const std::string &blob_name,
+                  size_t blob_off, size_t data_size) override {
+    adapter::BlobPlacement p;
+    p.DecodeBlobName(blob_name, page_size_);
+    client.AsyncTagUpdateSize(mctx, chi::DomainQuery::GetDynamic(), tag_id,
+                              p.bucket_off_ + blob_off + data_size,
+                              UpdateSizeMode::kCap);
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_TASKS_DATA_STAGER_SRC_OBJECT_STAGER_H_
@@ -0,0 +1,447 @@
+//
+// Pluggable object store transports for the object stager
+//
+
+#ifndef HERMES_TASKS_DATA_STAGER_SRC_OBJECT_TRANSPORT_H_
+#define HERMES_TASKS_DATA_STAGER_SRC_OBJECT_TRANSPORT_H_
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "hermes/hermes.h"
+
+namespace hermes {
+
+/**
+ * A connection to an object store. Objects are read with ranged GETs and
+ * written with multipart uploads, where each part carries the byte range
+ * of the object it replaces. All methods may be called concurrently.
+ * */
+class ObjectTransport {
+ public:
+  virtual ~ObjectTransport() = default;
+
+  /** The size of object \a key, or 0 if it doesn't exist */
+  virtual size_t GetSize(const std::string &key) = 0;
+
+  /**
+   * Read [off, off + size) of object \a key into \a iov, where size is
+   * the total length of the buffers.
+   *
+   * @return the number of bytes read (short at the end of the object),
+   * or -1 on failure
+   * */
+  virtual ssize_t GetRange(const std::string &key, size_t off,
+                           const struct iovec *iov, int iovcnt) = 0;
+
+  /**
+   * Start a multipart upload to object \a key.
+   *
+   * @return the upload id, or an empty string on failure
+   * */
+  virtual std::string CreateUpload(const std::string &key) = 0;
+
+  /**
+   * The smallest size the store accepts for a part that is not the last
+   * part of its upload (5 MiB for S3), or 0 if there is no minimum.
+   * */
+  virtual size_t GetMinPartSize() { return 0; }
+
+  /** Upload part \a part_num, which replaces the range at \a off */
+  virtual bool UploadPart(const std::string &key, const std::string &upload_id,
+                          int part_num, size_t off, const struct iovec *iov,
+                          int iovcnt) = 0;
+
+  /** Apply the parts of an upload to the object */
+  virtual bool CompleteUpload(const std::string &key,
+                              const std::string &upload_id) = 0;
+
+  /** Drop the parts of an upload */
+  virtual void AbortUpload(const std::string &key,
+                           const std::string &upload_id) = 0;
+
+  /**
+   * Connect to the object store at \a uri. "file://<dir>" is a store kept
+   * in a local directory.
+   *
+   * @return nullptr if the scheme is unknown
+   * */
+  static std::unique_ptr<ObjectTransport> Create(const std::string &uri);
+};
+
+/**
+ * An object store kept in a local directory, for testing. Each object is
+ * a file under the root. Parts are written to files under
+ * <root>/.uploads/<upload_id>. Completing an upload applies the parts in
+ * part order to a copy of the object in that directory, which is then
+ * renamed over the object, so readers see all of an upload or none of it.
+ * The failed copy is dropped with the upload's directory. Completions are
+ * serialized by an flock on <root>/.uploads/.lock.
+ * */
+class LocalObjectTransport : public ObjectTransport {
+ public:
+  std::string root_;
+
+ public:
+  /** Keep objects under \a root */
+  explicit LocalObjectTransport(const std::string &root) : root_(root) {}
+
+  /** The file holding object \a key */
+  std::string GetObjectPath(const std::string &key) {
+    size_t start = key.find_first_not_of('/');
+    if (start == std::string::npos) {
+      start = key.size();
+    }
+    return root_ + "/" + key.substr(start);
+  }
+
+  /** The directory holding the directories of the uploads */
+  std::string GetUploadsPath() { return root_ + "/.uploads"; }
+
+  /** The directory holding the parts of an upload */
+  std::string GetUploadPath(const std::string &upload_id) {
+    return GetUploadsPath() + "/" + upload_id;
+  }
+
+  size_t GetSize(const std::string &key) override {
+    struct stat buf;
+    if (HERMES_POSIX_API->stat(GetObjectPath(key).c_str(), &buf) < 0) {
+      return 0;
+    }
+    return buf.st_size;
+  }
+
+  ssize_t GetRange(const std::string &key, size_t off,
+                   const struct iovec *iov, int iovcnt) override {
+    int fd = HERMES_POSIX_API->open(GetObjectPath(key).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return -1;
+    }
+    ssize_t ret = HERMES_POSIX_API->preadv(fd, iov, iovcnt, (off_t)off);
+    HERMES_POSIX_API->close(fd);
+    return ret;
+  }
+
+  /**
+   * Start an upload in a new directory. mkdtemp names it, so uploads from
+   * any transport, process or host sharing the root never collide.
+   * */
+  std::string CreateUpload(const std::string &key) override {
+    std::error_code err;
+    std::filesystem::create_directories(GetUploadsPath(), err);
+    std::string upload_path = GetUploadsPath() + "/XXXXXX";
+    if (err || !mkdtemp(&upload_path[0])) {
+      HELOG(kError, "Failed to start an upload to {}: {}", key,
+            err ? err.message() : strerror(errno));
+      return "";
+    }
+    return std::filesystem::path(upload_path).filename().string();
+  }
+
+  bool UploadPart(const std::string &key, const std::string &upload_id,
+                  int part_num, size_t off, const struct iovec *iov,
+                  int iovcnt) override {
+    // The part's file name records its number and offset
+    std::string part_path = GetUploadPath(upload_id) + "/" +
+                            std::to_string(part_num) + "." +
+                            std::to_string(off);
+    int fd = HERMES_POSIX_API->open(part_path.c_str(),
+                                    O_CREAT | O_TRUNC | O_WRONLY, 0666);
+    if (fd < 0) {
+      return false;
+    }
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      size += iov[i].iov_len;
+    }
+    ssize_t ret = HERMES_POSIX_API->pwritev(fd, iov, iovcnt, 0);
+    HERMES_POSIX_API->close(fd);
+    return ret >= 0 && (size_t)ret == size;
+  }
+
+  bool CompleteUpload(const std::string &key,
+                      const std::string &upload_id) override {
+    std::string upload_path = GetUploadPath(upload_id);
+    std::string obj_path = GetObjectPath(key);
+    bool ok = ApplyUpload(upload_path, obj_path);
+    std::error_code err;
+    std::filesystem::remove_all(upload_path, err);
+    return ok;
+  }
+
+  void AbortUpload(const std::string &key,
+                   const std::string &upload_id) override {
+    std::error_code err;
+    std::filesystem::remove_all(GetUploadPath(upload_id), err);
+  }
+
+ private:
+  /** The parts of the upload in \a upload_path, in part order */
+  static bool ListParts(
+      const std::string &upload_path,
+      std::vector<std::tuple<int, size_t, std::string>> &parts) {
+    std::error_code err;
+    std::filesystem::directory_iterator it(upload_path, err), end;
+    for (; !err && it != end; it.increment(err)) {
+      std::string name = it->path().filename().string();
+      int part_num;
+      unsigned long long off;
+      if (sscanf(name.c_str(), "%d.%llu", &part_num, &off) != 2) {
+        continue;
+      }
+      parts.emplace_back(part_num, (size_t)off, it->path().string());
+    }
+    if (err) {
+      HELOG(kError, "Failed to list the parts in {}: {}", upload_path,
+            err.message());
+      return false;
+    }
+    std::sort(parts.begin(), parts.end());
+    return true;
+  }
+
+  /**
+   * Apply the parts in \a upload_path to the object at \a obj_path while
+   * holding the root's upload lock.
+   * */
+  bool ApplyUpload(const std::string &upload_path,
+                   const std::string &obj_path) {
+    std::vector<std::tuple<int, size_t, std::string>> parts;
+    if (!ListParts(upload_path, parts)) {
+      return false;
+    }
+    std::error_code err;
+    std::filesystem::create_directories(
+        std::filesystem::path(obj_path).parent_path(), err);
+    if (err) {
+      HELOG(kError, "Failed to create the directory of {}: {}", obj_path,
+            err.message());
+      return false;
+    }
+    // Applying is a read-modify-write of the object, so the uploads to a
+    // root are applied one at a time across threads and processes
+    std::string lock_path = GetUploadsPath() + "/.lock";
+    int lock_fd = HERMES_POSIX_API->open(lock_path.c_str(), O_CREAT | O_RDWR,
+                                         0666);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) < 0) {
+      HELOG(kError, "Failed to lock {}: {}", lock_path, strerror(errno));
+      if (lock_fd >= 0) {
+        HERMES_POSIX_API->close(lock_fd);
+      }
+      return false;
+    }
+    bool ok = ApplyParts(parts, upload_path + "/object", obj_path);
+    // Closing the fd releases the lock
+    HERMES_POSIX_API->close(lock_fd);
+    return ok;
+  }
+
+  /**
+   * Apply \a parts to a copy of the object at \a obj_path in \a tmp_path
+   * and rename the copy over the object.
+   * */
+  static bool ApplyParts(
+      const std::vector<std::tuple<int, size_t, std::string>> &parts,
+      const std::string &tmp_path, const std::string &obj_path) {
+    std::error_code err;
+    if (std::filesystem::exists(obj_path, err)) {
+      std::filesystem::copy_file(
+          obj_path, tmp_path,
+          std::filesystem::copy_options::overwrite_existing, err);
+    }
+    if (err) {
+      HELOG(kError, "Failed to copy object {}: {}", obj_path, err.message());
+      return false;
+    }
+    int fd = HERMES_POSIX_API->open(tmp_path.c_str(), O_CREAT | O_WRONLY,
+                                    0666);
+    if (fd < 0) {
+      HELOG(kError, "Failed to open {}", tmp_path);
+      return false;
+    }
+    bool ok = true;
+    for (size_t i = 0; ok && i < parts.size(); ++i) {
+      ok = CopyPart(std::get<2>(parts[i]), fd, std::get<1>(parts[i]));
+    }
+    HERMES_POSIX_API->close(fd);
+    if (ok) {
+      std::filesystem::rename(tmp_path, obj_path, err);
+      if (err) {
+        HELOG(kError, "Failed to replace object {}: {}", obj_path,
+              err.message());
+        ok = false;
+      }
+    } else {
+      HELOG(kError, "Failed to apply an upload to {}", obj_path);
+    }
+    return ok;
+  }
+
+  /** Write the part in \a part_path to \a fd at \a off */
+  static bool CopyPart(const std::string &part_path, int fd, size_t off) {
+    int part_fd = HERMES_POSIX_API->open(part_path.c_str(), O_RDONLY);
+    if (part_fd < 0) {
+      return false;
+    }
+    std::vector<char> buf(MEGABYTES(1));
+    bool ok = true;
+    while (true) {
+      ssize_t ret = HERMES_POSIX_API->read(part_fd, buf.data(), buf.size());
+      if (ret <= 0) {
+        ok = ret == 0;
+        break;
+      }
+      if (HERMES_POSIX_API->pwrite(fd, buf.data(), ret, (off_t)off) != ret) {
+        ok = false;
+        break;
+      }
+      off += ret;
+    }
+    HERMES_POSIX_API->close(part_fd);
+    return ok;
+  }
+};
+
+inline std::unique_ptr<ObjectTransport> ObjectTransport::Create(
+    const std::string &uri) {
+  const std::string kFileScheme = "file://";
+  if (uri.rfind(kFileScheme, 0) == 0) {
+    return std::make_unique<LocalObjectTransport>(
+        uri.substr(kFileScheme.size()));
+  }
+  return nullptr;
+}
+
+/** An object store request handed to the ObjectRequestPool */
+struct ObjectRequest {
+  std::function<bool()> op_; /**< Runs the request. Returns success. */
+  bool ok_ = false;
+  std::atomic<bool> done_{false};
+
+  /** Default constructor */
+  ObjectRequest() = default;
+
+  /** Emplace constructor */
+  explicit ObjectRequest(std::function<bool()> op) : op_(std::move(op)) {}
+
+  /** Copy constructor (for vectors of requests that aren't submitted yet) */
+  ObjectRequest(const ObjectRequest &other)
+      : op_(other.op_), ok_(other.ok_), done_(other.done_.load()) {}
+
+  /** Whether the request finished */
+  bool IsComplete() const { return done_.load(std::memory_order_acquire); }
+};
+
+/**
+ * Runs object store requests on a pool of threads so that many ranged
+ * GETs and part uploads are in flight at once. Tasks yield while their
+ * requests run, like with AsyncIoEngine.
+ * */
+class ObjectRequestPool {
+ public:
+  std::vector<std::thread> threads_;
+  std::deque<ObjectRequest *> queue_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+
+ public:
+  /** Start \a num_threads request threads */
+  explicit ObjectRequestPool(size_t num_threads = 16) {
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { Serve(); });
+    }
+  }
+
+  /** Stop the request threads */
+  ~ObjectRequestPool() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  /** The node-wide pool */
+  static ObjectRequestPool *Get() {
+    static ObjectRequestPool pool;
+    return &pool;
+  }
+
+  /**
+   * Run \a reqs in parallel and wait for all of them. \a task yields
+   * between polls so the worker can run other tasks meanwhile.
+   *
+   * @return whether every request succeeded
+   * */
+  static bool Run(Task *task, std::vector<ObjectRequest> &reqs) {
+    if (reqs.empty()) {
+      return true;
+    }
+    ObjectRequestPool *pool = Get();
+    {
+      std::lock_guard<std::mutex> lock(pool->lock_);
+      for (ObjectRequest &req : reqs) {
+        pool->queue_.emplace_back(&req);
+      }
+    }
+    pool->cv_.notify_all();
+    bool ok = true;
+    for (ObjectRequest &req : reqs) {
+      while (!req.IsComplete()) {
+        if (task) {
+          task->Yield();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      ok &= req.ok_;
+    }
+    return ok;
+  }
+
+ private:
+  /** Serve requests until stopped */
+  void Serve() {
+    while (true) {
+      ObjectRequest *req;
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        req = queue_.front();
+        queue_.pop_front();
+      }
+      req->ok_ = req->op_();
+      req->done_.store(true, std::memory_order_release);
+    }
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_TASKS_DATA_STAGER_SRC_OBJECT_TRANSPORT_H_
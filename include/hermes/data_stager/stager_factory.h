@@ -4,11 +4,17 @@
 
 #include "abstract_stager.h"
 #include "binary_stager.h"
+#include "mmap_stager.h"
+#include "object_stager.h"
 
 #ifdef HERMES_ENABLE_NVIDIA_GDS_ADAPTER
 #include "nvidia_gds_stager.h"
 #endif
 
+#ifdef HERMES_ENABLE_HDF5_STAGER
+#include "hdf5_stager.h"
+#endif
+
 namespace hermes {
 
 class StagerFactory {
@@ -22,9 +28,17 @@ class StagerFactory {
     std::unique_ptr<AbstractStager> stager;
     if (protocol == "file" || protocol == "") {
       stager = std::make_unique<BinaryFileStager>();
+    } else if (protocol == "mmap") {
+      stager = std::make_unique<MmapFileStager>();
+    } else if (protocol == "object") {
+      stager = std::make_unique<ObjectStager>();
     } else if (protocol == "parquet") {
-    } else if (protocol == "hdf5") {
     }
+#ifdef HERMES_ENABLE_HDF5_STAGER
+    else if (protocol == "hdf5") {
+      stager = std::make_unique<Hdf5Stager>();
+    }
+#endif
 #ifdef HERMES_ENABLE_NVIDIA_GDS_ADAPTER
     else if (protocol == "nvidia_gds") {
       stager = std::make_unique<NvidiaGdsStager>();
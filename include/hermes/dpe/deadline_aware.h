@@ -0,0 +1,83 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_SRC_DPE_DEADLINE_AWARE_H_
+#define HERMES_SRC_DPE_DEADLINE_AWARE_H_
+
+#include "dpe.h"
+#include "minimize_io_time.h"
+
+namespace hermes {
+
+/**
+ A class to represent data placement engine that places each blob on
+ the cheapest (slowest) target which still meets the bucket's latency
+ and throughput objective. Latency-critical buckets then keep the fast
+ tiers, while bulk buckets are pushed down the hierarchy. Buckets without
+ an objective are placed by MinimizeIoTime, which honors the blob score.
+*/
+class DeadlineAware : public Dpe {
+ public:
+  DeadlineAware() = default;
+  ~DeadlineAware() = default;
+
+  Status Placement(const std::vector<size_t> &blob_sizes,
+                   std::vector<TargetInfo> &targets, Context &ctx,
+                   std::vector<PlacementSchema> &output) override {
+    if (!ctx.objective_.IsSet()) {
+      return hshm::Singleton<MinimizeIoTime>::GetInstance()->Placement(
+          blob_sizes, targets, ctx, output);
+    }
+    // Sort the targets from cheapest to most expensive
+    std::sort(targets.begin(), targets.end(),
+              [](const TargetInfo &a, const TargetInfo &b) {
+                return a.stats_->write_bw_ < b.stats_->write_bw_;
+              });
+    for (size_t blob_size : blob_sizes) {
+      output.emplace_back();
+      PlacementSchema &blob_schema = output.back();
+
+      // Find the cheapest target meeting the objective. If none do,
+      // use the target with the lowest predicted latency.
+      TargetInfo *best = nullptr;
+      float best_lat = 0;
+      for (TargetInfo &target : targets) {
+        // NOTE(llogan): We skip targets that can't fit the ENTIRE blob
+        if (target.GetRemCap() < blob_size) {
+          continue;
+        }
+        if (MeetsObjective(target, blob_size, ctx)) {
+          best = &target;
+          break;
+        }
+        float lat = PredictLatencyUs(target, blob_size);
+        if (best == nullptr || lat < best_lat) {
+          best = &target;
+          best_lat = lat;
+        }
+      }
+      if (best == nullptr) {
+        return DPE_MIN_IO_TIME_NO_SOLUTION;
+      }
+      if (ctx.blob_score_ == -1) {
+        ctx.blob_score_ = best->score_;
+      }
+      blob_schema.plcmnts_.emplace_back(blob_size, best->id_);
+    }
+
+    return Status();
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_SRC_DPE_DEADLINE_AWARE_H_
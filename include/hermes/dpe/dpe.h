@@ -39,6 +39,63 @@ class Dpe {
   virtual Status Placement(const std::vector<size_t> &blob_sizes,
                            std::vector<TargetInfo> &targets, Context &ctx,
                            std::vector<PlacementSchema> &output) = 0;
+
+  /**
+   * Calculate the placement of a set of blobs, preferring the targets
+   * located on \a node_id. Remote targets are only considered when the
+   * local targets cannot hold the blobs.
+   * */
+  Status LocalityPlacement(const std::vector<size_t> &blob_sizes,
+                           std::vector<TargetInfo> &targets,
+                           chi::NodeId node_id, Context &ctx,
+                           std::vector<PlacementSchema> &output) {
+    std::vector<TargetInfo> local;
+    local.reserve(targets.size());
+    for (TargetInfo &target : targets) {
+      if (target.id_.node_id_ == node_id) {
+        local.emplace_back(target);
+      }
+    }
+    if (!local.empty() && local.size() < targets.size()) {
+      float blob_score = ctx.blob_score_;
+      Status status = Placement(blob_sizes, local, ctx, output);
+      if (status.Success()) {
+        return status;
+      }
+      // The local tiers are full, spill to remote targets
+      output.clear();
+      ctx.blob_score_ = blob_score;
+    }
+    return Placement(blob_sizes, targets, ctx, output);
+  }
+
+  /**
+   * Predict the time (us) to write \a size bytes to \a target. Requests
+   * already queued on the target are assumed to be served first.
+   * */
+  static float PredictLatencyUs(const TargetInfo &target, size_t size) {
+    float bw = target.stats_->write_bw_;  // MBps, i.e., bytes per us
+    float xfer_us = bw > 0 ? (float)size / bw : 0;
+    float io_us = target.stats_->write_latency_ + xfer_us;
+    return io_us * (float)(1 + target.GetQueueDepth());
+  }
+
+  /** Whether \a target meets the placement objective of \a ctx */
+  static bool MeetsObjective(const TargetInfo &target, size_t size,
+                             const Context &ctx) {
+    const PlacementObjective &obj = ctx.objective_;
+    if (obj.max_latency_us_ > 0 &&
+        PredictLatencyUs(target, size) > obj.max_latency_us_) {
+      return false;
+    }
+    if (obj.min_bandwidth_mbps_ > 0) {
+      float bw = target.stats_->write_bw_ / (float)(1 + target.GetQueueDepth());
+      if (bw < obj.min_bandwidth_mbps_) {
+        return false;
+      }
+    }
+    return true;
+  }
 };
 
 }  // namespace hermes
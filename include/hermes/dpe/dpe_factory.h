@@ -15,7 +15,9 @@
 
 #include "dpe.h"
 #include "hermes/hermes.h"
+#include "deadline_aware.h"
 #include "minimize_io_time.h"
+#include "power_of_two.h"
 #include "random.h"
 #include "round_robin.h"
 
@@ -48,6 +50,12 @@ class DpeFactory {
       case PlacementPolicy::kMinimizeIoTime: {
         return hshm::Singleton<MinimizeIoTime>::GetInstance();
       }
+      case PlacementPolicy::kPowerOfTwo: {
+        return hshm::Singleton<PowerOfTwo>::GetInstance();
+      }
+      case PlacementPolicy::kDeadlineAware: {
+        return hshm::Singleton<DeadlineAware>::GetInstance();
+      }
       case PlacementPolicy::kNone:
       default: {
         HELOG(kFatal, "PlacementPolicy not implemented");
@@ -55,6 +63,17 @@ class DpeFactory {
       }
     }
   }
+
+  /**
+   * return the data placement engine for a context. Buckets with a
+   * placement objective and no explicit policy use DeadlineAware.
+   * */
+  static Dpe* Get(const Context &ctx) {
+    if (ctx.dpe_ == PlacementPolicy::kNone && ctx.objective_.IsSet()) {
+      return Get(PlacementPolicy::kDeadlineAware);
+    }
+    return Get(ctx.dpe_);
+  }
 };
 
 }  // namespace hermes
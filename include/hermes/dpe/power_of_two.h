@@ -0,0 +1,104 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_SRC_DPE_POWER_OF_TWO_H_
+#define HERMES_SRC_DPE_POWER_OF_TWO_H_
+
+#include "dpe.h"
+
+namespace hermes {
+
+/**
+ A class to represent data placement engine that samples two eligible
+ targets and places the blob on the least loaded of the two.
+*/
+class PowerOfTwo : public Dpe {
+ private:
+  std::atomic<u64> seed_;
+
+ public:
+  PowerOfTwo() : seed_(2989248848) {}
+  ~PowerOfTwo() = default;
+
+  Status Placement(const std::vector<size_t> &blob_sizes,
+                   std::vector<TargetInfo> &targets, Context &ctx,
+                   std::vector<PlacementSchema> &output) override {
+    std::vector<u32> eligible;
+    eligible.reserve(targets.size());
+    for (size_t blob_size : blob_sizes) {
+      output.emplace_back();
+      PlacementSchema &blob_schema = output.back();
+
+      // NOTE(llogan): We skip targets that can't fit the ENTIRE blob
+      eligible.clear();
+      for (u32 tgt_idx = 0; tgt_idx < targets.size(); ++tgt_idx) {
+        if (targets[tgt_idx].GetRemCap() >= blob_size) {
+          eligible.emplace_back(tgt_idx);
+        }
+      }
+      if (eligible.empty()) {
+        return DPE_MIN_IO_TIME_NO_SOLUTION;
+      }
+
+      // Sample two distinct targets and keep the less loaded one
+      TargetInfo *target = &targets[eligible[0]];
+      if (eligible.size() > 1) {
+        u64 rand = NextRand();
+        size_t a = rand % eligible.size();
+        size_t b = (a + 1 + (rand >> 32) % (eligible.size() - 1)) %
+                   eligible.size();
+        TargetInfo &tgt_a = targets[eligible[a]];
+        TargetInfo &tgt_b = targets[eligible[b]];
+        target = IsLessLoaded(tgt_b, tgt_a) ? &tgt_b : &tgt_a;
+      }
+      if (ctx.blob_score_ == -1) {
+        ctx.blob_score_ = target->score_;
+      }
+      blob_schema.plcmnts_.emplace_back(blob_size, target->id_);
+    }
+
+    return Status();
+  }
+
+ private:
+  /** Whether \a a should be preferred over \a b */
+  static bool IsLessLoaded(TargetInfo &a, TargetInfo &b) {
+    size_t depth_a = a.GetQueueDepth(), depth_b = b.GetQueueDepth();
+    if (depth_a != depth_b) {
+      return depth_a < depth_b;
+    }
+    return a.GetRemCap() > b.GetRemCap();
+  }
+
+  /**
+   * Xorshift generator kept per worker thread. Lanes are pinned to
+   * workers, so concurrent placements never share generator state.
+   * */
+  u64 NextRand() {
+    thread_local u64 state = 0;
+    if (state == 0) {
+      // Seed each worker differently using splitmix64
+      u64 z = seed_.fetch_add(0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      state = (z ^ (z >> 31)) | 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_SRC_DPE_POWER_OF_TWO_H_
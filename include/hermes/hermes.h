@@ -35,6 +35,18 @@ class Hermes {
   /** Get a bucket */
   Bucket GetBucket(const std::string &name) { return hermes::Bucket(name); }
 
+  /**
+   * Stage [off, off + size) of a bucket's backend in ahead of use, e.g.
+   * to warm a file before the compute phase. A size of 0 stages in the
+   * rest of the backend. The bucket must have a stager, such as a file
+   * opened through an adapter or a bucket created with
+   * BinaryFileStager::BuildContext.
+   * */
+  void Prestage(const std::string &name, size_t off = 0, size_t size = 0,
+                float score = 1) {
+    GetBucket(name).Prestage(off, size, score);
+  }
+
   /** Collects blob metadata */
   std::vector<BlobInfo> PollBlobMetadata(const std::string &filter,
                                          int max_count) {
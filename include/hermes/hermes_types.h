@@ -42,15 +42,158 @@ typedef UniqueId<102> TagId;
 /** Represents a storage target */
 typedef PoolId TargetId;
 
+/**
+ * Slab class bookkeeping for a target. Allocations are rounded to the
+ * device's slab classes so that freed extents can be reused by later blobs.
+ *
+ * The bdev's free lists are not visible here, so free extent counts are
+ * estimates: an allocation is assumed to reuse a freed extent of its class
+ * whenever one was freed earlier, which may not be what the bdev did.
+ * */
+struct SlabStats {
+  std::vector<size_t> slab_sizes_; /**< The slab classes (ascending) */
+  std::unique_ptr<std::atomic<size_t>[]> used_; /**< Live extents per class */
+  /** Estimated freed, not yet reused extents per class */
+  std::unique_ptr<std::atomic<size_t>[]> est_free_;
+
+  /** Initialize the slab classes of the target */
+  void Init(const std::vector<size_t> &slab_sizes) {
+    slab_sizes_ = slab_sizes;
+    std::sort(slab_sizes_.begin(), slab_sizes_.end());
+    used_ = std::make_unique<std::atomic<size_t>[]>(slab_sizes_.size());
+    est_free_ = std::make_unique<std::atomic<size_t>[]>(slab_sizes_.size());
+    for (size_t i = 0; i < slab_sizes_.size(); ++i) {
+      used_[i] = 0;
+      est_free_[i] = 0;
+    }
+  }
+
+  /** Get the smallest slab class which can hold \a size bytes */
+  size_t GetSlabClass(size_t size) const {
+    for (size_t i = 0; i < slab_sizes_.size(); ++i) {
+      if (size <= slab_sizes_[i]) {
+        return i;
+      }
+    }
+    return slab_sizes_.size() - 1;
+  }
+
+  /**
+   * Round an allocation of \a size bytes to the slab classes. Whole
+   * max-size slabs are used first. The tail is coalesced into a single
+   * slab when at most half of that slab would be wasted. Otherwise, the
+   * largest slab smaller than the tail is carved off and the rest of the
+   * tail is rounded again.
+   * */
+  size_t RoundUp(size_t size) const {
+    if (slab_sizes_.empty() || size == 0) {
+      return size;
+    }
+    size_t max_slab = slab_sizes_.back();
+    size_t rounded = (size / max_slab) * max_slab;
+    size_t tail = size % max_slab;
+    while (tail > 0) {
+      size_t cls = GetSlabClass(tail);
+      size_t slab_size = slab_sizes_[cls];
+      if (cls == 0 || slab_size <= 2 * tail) {
+        rounded += slab_size;
+        break;
+      }
+      rounded += slab_sizes_[cls - 1];
+      tail -= slab_sizes_[cls - 1];
+    }
+    return rounded;
+  }
+
+  /**
+   * Record an extent handed out by the target. It is assumed to reuse a
+   * freed extent of its class, if any.
+   * */
+  void Allocated(size_t size) {
+    if (slab_sizes_.empty()) {
+      return;
+    }
+    size_t cls = GetSlabClass(size);
+    used_[cls].fetch_add(1);
+    DecrementIfPositive(est_free_[cls]);
+  }
+
+  /** Record an extent returned to the target */
+  void Freed(size_t size) {
+    if (slab_sizes_.empty()) {
+      return;
+    }
+    size_t cls = GetSlabClass(size);
+    DecrementIfPositive(used_[cls]);
+    est_free_[cls].fetch_add(1);
+  }
+
+  /**
+   * Estimate the fraction of freed extent bytes that are not in the largest
+   * slab class from est_free_. 0 means freed space is likely reusable by
+   * large blobs.
+   * */
+  float EstimateFragmentation() const {
+    if (slab_sizes_.empty()) {
+      return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < slab_sizes_.size(); ++i) {
+      total += est_free_[i].load() * slab_sizes_[i];
+    }
+    if (total == 0) {
+      return 0;
+    }
+    size_t large =
+        est_free_[slab_sizes_.size() - 1].load() * slab_sizes_.back();
+    return 1 - (float)large / (float)total;
+  }
+
+ private:
+  /** Decrement a counter without wrapping below zero */
+  static void DecrementIfPositive(std::atomic<size_t> &count) {
+    size_t cur = count.load();
+    while (cur > 0 && !count.compare_exchange_weak(cur, cur - 1)) {
+    }
+  }
+};
+
+/** Foreground I/O statistics of a target, shared by all lanes */
+struct TargetIoStats {
+  std::atomic<size_t> queue_depth_{0}; /**< Number of in-flight bdev I/Os */
+  std::atomic<size_t> io_count_{0};    /**< Number of foreground blob I/Os */
+  size_t last_io_count_ = 0;     /**< io_count_ at the last flush sweep */
+  std::atomic<size_t> raw_bytes_{0};    /**< Uncompressed bytes stored */
+  std::atomic<size_t> stored_bytes_{0}; /**< What they occupy compressed */
+  hshm::Timepoint idle_since_;   /**< When io_count_ last changed */
+};
+
 /** Represents a target */
 struct TargetInfo {
   TargetId id_;
   chi::bdev::Client client_;
   FullPtr<chi::bdev::PollStatsTask> poll_stats_;
   chi::BdevStats *stats_;
-  float score_ = 0;  // TODO(llogan): Calculate score
+  SlabStats *slabs_ = nullptr; /**< Slab classes of the target's device */
+  TargetIoStats *io_stats_ = nullptr; /**< Foreground I/O statistics */
+  float score_ = 0; /**< Tier rank by write bandwidth (0 = slowest) */
+  float borg_min_thresh_ = 0; /**< Promote into the target below this */
+  float borg_max_thresh_ = 1; /**< Demote out of the target above this */
+  u8 codec_ = 0; /**< CompressCodec applied to blobs placed here */
 
   size_t GetRemCap() { return stats_->free_; }
+
+  /** Fraction of the target's capacity in use */
+  float GetUtilization() {
+    if (stats_->max_cap_ == 0) {
+      return 0;
+    }
+    return 1 - (float)stats_->free_ / stats_->max_cap_;
+  }
+
+  size_t GetQueueDepth() const {
+    return io_stats_ ? io_stats_->queue_depth_.load() : 0;
+  }
 };
 
 /** Basic target statistics summary */
@@ -62,10 +205,20 @@ struct TargetStats {
   float bandwidth_;
   float latency_;
   float score_;
+  std::vector<size_t> slab_sizes_;       /**< The slab classes of the target */
+  std::vector<size_t> used_extents_;     /**< Live extents per slab class */
+  std::vector<size_t> est_free_extents_; /**< Estimated, see SlabStats */
+  float est_fragmentation_; /**< See SlabStats::EstimateFragmentation */
+  u8 codec_;                /**< CompressCodec of the target */
+  size_t raw_bytes_;    /**< Uncompressed bytes held in compressed form */
+  size_t stored_bytes_; /**< Bytes those occupy on the target */
+  ssize_t effective_cap_; /**< max_cap_ plus the bytes compression saved */
 
   template <typename Ar>
   void serialize(Ar &ar) {
-    ar(tgt_id_, node_id_, rem_cap_, max_cap_, bandwidth_, latency_, score_);
+    ar(tgt_id_, node_id_, rem_cap_, max_cap_, bandwidth_, latency_, score_,
+       slab_sizes_, used_extents_, est_free_extents_, est_fragmentation_,
+       codec_, raw_bytes_, stored_bytes_, effective_cap_);
   }
 };
 
@@ -251,6 +404,8 @@ enum class PlacementPolicy {
   kRandom,         /**< Random blob placement */
   kRoundRobin,     /**< Round-Robin (around devices) blob placement */
   kMinimizeIoTime, /**< LP-based blob placement, minimize I/O time */
+  kPowerOfTwo,     /**< Least loaded of two randomly-sampled targets */
+  kDeadlineAware,  /**< Cheapest target meeting a latency objective */
   kNone,           /**< No Dpe for cases we want it disabled */
 };
 
@@ -269,6 +424,12 @@ class PlacementPolicyConv {
       case PlacementPolicy::kMinimizeIoTime: {
         return "PlacementPolicy::kMinimizeIoTime";
       }
+      case PlacementPolicy::kPowerOfTwo: {
+        return "PlacementPolicy::kPowerOfTwo";
+      }
+      case PlacementPolicy::kDeadlineAware: {
+        return "PlacementPolicy::kDeadlineAware";
+      }
       case PlacementPolicy::kNone: {
         return "PlacementPolicy::kNone";
       }
@@ -284,6 +445,10 @@ class PlacementPolicyConv {
       return PlacementPolicy::kRoundRobin;
     } else if (policy.find("MinimizeIoTime") != std::string::npos) {
       return PlacementPolicy::kMinimizeIoTime;
+    } else if (policy.find("PowerOfTwo") != std::string::npos) {
+      return PlacementPolicy::kPowerOfTwo;
+    } else if (policy.find("DeadlineAware") != std::string::npos) {
+      return PlacementPolicy::kDeadlineAware;
     } else if (policy.find("None") != std::string::npos) {
       return PlacementPolicy::kNone;
     }
@@ -291,6 +456,24 @@ class PlacementPolicyConv {
   }
 };
 
+/**
+ * The service level a bucket expects from the placement engine.
+ * A value of 0 means the bucket has no objective for that metric.
+ * */
+struct PlacementObjective {
+  float max_latency_us_ = 0;     /**< Latency budget of each I/O (us) */
+  float min_bandwidth_mbps_ = 0; /**< Throughput the bucket needs (MBps) */
+
+  /** Whether any objective is set */
+  bool IsSet() const { return max_latency_us_ > 0 || min_bandwidth_mbps_ > 0; }
+
+  /** Serialization */
+  template <typename Ar>
+  void serialize(Ar &ar) {
+    ar(max_latency_us_, min_bandwidth_mbps_);
+  }
+};
+
 /** Hermes API call context */
 struct Context {
   /** Memory context */
@@ -311,6 +494,9 @@ struct Context {
   /** The node id the blob will be accessed from */
   u32 node_id_;
 
+  /** The latency / throughput objective of the bucket */
+  PlacementObjective objective_;
+
   Context()
       : mctx_(HSHM_MCTX),
         dpe_(PlacementPolicy::kNone),
@@ -398,11 +584,14 @@ class Constant {
 /** Represents an allocated fraction of a target */
 struct BufferInfo : public chi::Block {
   TargetId tid_; /**< The destination target */
+  u8 codec_ = 0; /**< CompressCodec of the blob's data (0 is raw) */
+  size_t data_size_ = 0; /**< Compressed bytes held, if codec_ is set */
+  size_t raw_size_ = 0;  /**< Uncompressed bytes they stand for */
 
   /** Serialization */
   template <typename Ar>
   void serialize(Ar &ar) {
-    ar(tid_, off_, size_);
+    ar(tid_, off_, size_, codec_, data_size_, raw_size_);
   }
 
   /** Default constructor */
@@ -413,6 +602,46 @@ struct BufferInfo : public chi::Block {
       : tid_(tid), chi::Block(block) {}
 };
 
+/** A set of disjoint byte ranges [off, end), merged as they are added */
+struct ByteRangeSet {
+  std::vector<std::pair<size_t, size_t>> ranges_; /**< Sorted by offset */
+
+  /** Add the range [off, off + size) */
+  void Add(size_t off, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    size_t end = off + size;
+    // The first range that ends at or after off touches the new range
+    auto first = std::lower_bound(
+        ranges_.begin(), ranges_.end(), off,
+        [](const std::pair<size_t, size_t> &r, size_t off) {
+          return r.second < off;
+        });
+    auto last = first;
+    while (last != ranges_.end() && last->first <= end) {
+      off = std::min(off, last->first);
+      end = std::max(end, last->second);
+      ++last;
+    }
+    first = ranges_.erase(first, last);
+    ranges_.emplace(first, off, end);
+  }
+
+  /** Get the number of bytes covered */
+  size_t GetSize() const {
+    size_t size = 0;
+    for (const auto &r : ranges_) {
+      size += r.second - r.first;
+    }
+    return size;
+  }
+
+  bool empty() const { return ranges_.empty(); }
+  void clear() { ranges_.clear(); }
+  void swap(ByteRangeSet &other) { ranges_.swap(other.ranges_); }
+};
+
 /** Data structure used to store Blob information */
 struct BlobInfo {
   TagId tag_id_;                    /**< Tag the blob is on */
@@ -428,6 +657,7 @@ struct BlobInfo {
   hshm::Timepoint last_access_;   /**< Last time blob accessed */
   hipc::atomic<size_t> mod_count_;  /**< The number of times blob modified */
   hipc::atomic<size_t> last_flush_; /**< The last mod that was flushed */
+  ByteRangeSet dirty_;              /**< Ranges modified since last flush */
   bitfield32_t flags_;              /**< Flags */
 #ifdef CHIMAERA_RUNTIME
   chi::CoRwLock lock_; /**< Lock */
@@ -458,6 +688,7 @@ struct BlobInfo {
     last_access_ = other.last_access_;
     mod_count_ = other.mod_count_.load();
     last_flush_ = other.last_flush_.load();
+    dirty_ = other.dirty_;
   }
 
   /** Update modify stats */
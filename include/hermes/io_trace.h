@@ -0,0 +1,55 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_INCLUDE_HERMES_IO_TRACE_H_
+#define HERMES_INCLUDE_HERMES_IO_TRACE_H_
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
+#include <fstream>
+
+#include "hermes/hermes_types.h"
+
+namespace hermes {
+
+/**
+ * Persist a trace of I/O statistics, e.g., the output of
+ * Hermes::PollAccessPattern, so it can be replayed offline.
+ * */
+static inline bool SaveIoTrace(const std::string &path,
+                               const std::vector<IoStat> &trace) {
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs.is_open()) {
+    HELOG(kError, "Could not open trace file {} for writing", path);
+    return false;
+  }
+  cereal::BinaryOutputArchive ar(ofs);
+  ar(trace);
+  return true;
+}
+
+/** Load a trace of I/O statistics created by SaveIoTrace */
+static inline bool LoadIoTrace(const std::string &path,
+                               std::vector<IoStat> &trace) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs.is_open()) {
+    HELOG(kError, "Could not open trace file {} for reading", path);
+    return false;
+  }
+  cereal::BinaryInputArchive ar(ifs);
+  ar(trace);
+  return true;
+}
+
+}  // namespace hermes
+
+#endif  // HERMES_INCLUDE_HERMES_IO_TRACE_H_
@@ -0,0 +1,143 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_INCLUDE_HERMES_RCU_MAP_H_
+#define HERMES_INCLUDE_HERMES_RCU_MAP_H_
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace hermes {
+
+/**
+ * A read-mostly map with lock-free lookups (read-copy-update).
+ *
+ * Readers find keys in an immutable snapshot of the map. Writers copy
+ * the snapshot, change the copy, publish it, and free the old snapshot
+ * once the readers that may still see it are done. Readers only wait
+ * (retry) if a writer publishes while they enter, never on a lock.
+ * Values are copied out of the map, so lookups should return cheap
+ * handles such as shared_ptrs.
+ * */
+template <typename KeyT, typename ValT>
+class RcuMap {
+ public:
+  typedef std::unordered_map<KeyT, ValT> MAP_T;
+
+  /** A reader count on its own cache line */
+  struct alignas(64) ReaderCount {
+    std::atomic<size_t> count_{0};
+  };
+
+  std::atomic<const MAP_T *> map_;
+  std::atomic<size_t> epoch_{0};
+  ReaderCount readers_[2]; /**< Readers in the even and odd epochs */
+  std::mutex write_lock_;  /**< Serializes writers */
+
+ public:
+  /** Constructor */
+  RcuMap() : map_(new MAP_T()) {}
+
+  /** Destructor */
+  ~RcuMap() { delete map_.load(); }
+
+  RcuMap(const RcuMap &) = delete;
+  RcuMap &operator=(const RcuMap &) = delete;
+
+  /**
+   * Copy the value of \a key into \a val.
+   *
+   * @return whether the key was found
+   * */
+  bool Get(const KeyT &key, ValT &val) {
+    size_t epoch = ReadLock();
+    const MAP_T *map = map_.load();
+    auto it = map->find(key);
+    bool found = it != map->end();
+    if (found) {
+      val = it->second;
+    }
+    ReadUnlock(epoch);
+    return found;
+  }
+
+  /**
+   * Insert \a val under \a key if the key is not present.
+   *
+   * @return whether the value was inserted
+   * */
+  bool Emplace(const KeyT &key, const ValT &val) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    const MAP_T *map = map_.load();
+    if (map->find(key) != map->end()) {
+      return false;
+    }
+    MAP_T *copy = new MAP_T(*map);
+    copy->emplace(key, val);
+    Publish(copy);
+    return true;
+  }
+
+  /**
+   * Remove \a key.
+   *
+   * @return whether the key was present
+   * */
+  bool Erase(const KeyT &key) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    const MAP_T *map = map_.load();
+    if (map->find(key) == map->end()) {
+      return false;
+    }
+    MAP_T *copy = new MAP_T(*map);
+    copy->erase(key);
+    Publish(copy);
+    return true;
+  }
+
+ private:
+  /** Enter a read-side critical section. Returns the epoch entered. */
+  size_t ReadLock() {
+    while (true) {
+      size_t epoch = epoch_.load();
+      readers_[epoch & 1].count_.fetch_add(1);
+      // A writer that flipped the epoch meanwhile may not see this reader
+      if (epoch_.load() == epoch) {
+        return epoch;
+      }
+      readers_[epoch & 1].count_.fetch_sub(1);
+    }
+  }
+
+  /** Leave a read-side critical section */
+  void ReadUnlock(size_t epoch) { readers_[epoch & 1].count_.fetch_sub(1); }
+
+  /**
+   * Publish a new snapshot and free the old one once no reader can see
+   * it. Readers never yield while they hold a snapshot, so the wait is
+   * short. The caller holds the write lock.
+   * */
+  void Publish(const MAP_T *copy) {
+    const MAP_T *old = map_.exchange(copy);
+    size_t epoch = epoch_.fetch_add(1);
+    while (readers_[epoch & 1].count_.load() != 0) {
+      std::this_thread::yield();
+    }
+    delete old;
+  }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_INCLUDE_HERMES_RCU_MAP_H_
@@ -13,154 +13,180 @@
 #ifndef HERMES_INCLUDE_HERMES_SCORE_HISTOGRAM_H_
 #define HERMES_INCLUDE_HERMES_SCORE_HISTOGRAM_H_
 
-#include <vector>
+#include <chimaera/chimaera_types.h>
+
 #include <atomic>
-#include <chimaera/chimaea_types.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace hermes {
 
-struct HistEntry {
-  std::atomic<u32> x_;
-
-  /** Default constructor */
-  HistEntry() : x_(0) {}
-
-  /** Constructor */
-  explicit HistEntry(int x) : x_(x) {}
-
-  /** Copy constructor */
-  explicit HistEntry(const HistEntry &other) : x_(other.x_.load()) {}
-
-  /** Copy operator */
-  HistEntry &operator=(const HistEntry &other) {
-    x_.store(other.x_.load());
-    return *this;
-  }
-
-  /** Move constructor */
-  HistEntry(HistEntry &&other) noexcept : x_(other.x_.load()) {}
-
-  /** Move operator */
-  HistEntry &operator=(HistEntry &&other) noexcept {
-    x_.store(other.x_.load());
-    return *this;
-  }
-
-  void increment() {
-    x_.fetch_add(1);
-  }
+/** Counts a lane added to each bin since the last merge */
+struct alignas(64) HistShard {
+  std::unique_ptr<std::atomic<i64>[]> deltas_;
+  std::atomic<bool> dirty_{false};
 };
 
+/**
+ * A histogram of blob scores in [0, 1].
+ *
+ * Lanes update their own shard so they never contend on the same
+ * counters. Shards are folded into a Fenwick tree on the next query,
+ * which answers percentiles and quantiles in O(log n) of the bins.
+ * */
 class Histogram {
  public:
-  std::vector<HistEntry> histogram_;
-  std::atomic<u32> count_;
+  u32 num_bins_ = 0;
+  u32 num_shards_ = 0;
+  std::unique_ptr<HistShard[]> shards_;
+  std::vector<i64> tree_; /**< 1-indexed Fenwick tree over the bins */
+  i64 count_ = 0;         /**< Total number of merged entries */
+  std::mutex lock_;       /**< Guards tree_ and count_ */
 
  public:
   /** Default constructor */
-  Histogram() : histogram_(), count_(0) {}
-
-  /** Copy constructor */
-  Histogram(const Histogram &other) : histogram_(other.histogram_),
-                                      count_(other.count_.load()) {}
-
-  /** Copy operator */
-  Histogram &operator=(const Histogram &other) {
-    histogram_ = other.histogram_;
-    count_.store(other.count_.load());
-    return *this;
-  }
-
-  /** Move constructor */
-  Histogram(Histogram &&other) noexcept : histogram_(other.histogram_),
-                                          count_(other.count_.load()) {}
-
-  /** Move operator */
-  Histogram &operator=(Histogram &&other) noexcept {
-    histogram_ = other.histogram_;
-    count_.store(other.count_.load());
-    return *this;
-  }
-
-  /** Resize the histogram */
-  void Resize(int num_bins) {
-    histogram_.resize(num_bins);
+  Histogram() = default;
+
+  /** Resize the histogram. Clears all counts. */
+  void Resize(u32 num_bins, u32 num_shards = 1) {
+    num_bins_ = num_bins;
+    num_shards_ = num_shards ? num_shards : 1;
+    shards_ = std::make_unique<HistShard[]>(num_shards_);
+    for (u32 i = 0; i < num_shards_; ++i) {
+      shards_[i].deltas_ = std::make_unique<std::atomic<i64>[]>(num_bins_);
+      for (u32 bin = 0; bin < num_bins_; ++bin) {
+        shards_[i].deltas_[bin] = 0;
+      }
+    }
+    tree_.assign(num_bins_ + 1, 0);
+    count_ = 0;
   }
 
   /** Get the bin score belongs to */
-  u32 GetBin(float score) {
-    u32 bin = score * histogram_.size();
-    if (bin >= histogram_.size()) {
-      bin = histogram_.size() - 1;
+  u32 GetBin(float score) const {
+    if (score <= 0) {
+      return 0;
+    }
+    u32 bin = score * num_bins_;
+    if (bin >= num_bins_) {
+      bin = num_bins_ - 1;
     }
     return bin;
   }
 
-  /** Increment histogram */
-  void Increment(float score) {
-    u32 bin = GetBin(score);
-    histogram_[bin].increment();
-    count_.fetch_add(1);
-  }
+  /** Increment histogram from lane \a shard */
+  void Increment(float score, u32 shard = 0) { Update(score, 1, shard); }
 
-  /** Decrement histogram */
-  void Decrement(float score) {
-    u32 bin = GetBin(score);
-    histogram_[bin].x_.fetch_sub(1);
-    count_.fetch_sub(1);
+  /** Decrement histogram from lane \a shard */
+  void Decrement(float score, u32 shard = 0) { Update(score, -1, shard); }
+
+  /** Get the total number of entries */
+  u64 GetCount() {
+    std::lock_guard<std::mutex> lock(lock_);
+    Merge();
+    return count_ > 0 ? count_ : 0;
   }
 
   /**
-   * Determine if a blob should be elevated (1),
-   * stationary (0), or demoted (-1)
+   * Get the percentage of entries with a score in a bin below (or equal
+   * to, if LESS_THAN_EQUAL) the bin of score.
    *
    * @input score a number between 0 and 1
    * @return Percentile (a number between 0 and 100)
    * */
-  template<bool LESS_THAN_EQUAL>
+  template <bool LESS_THAN_EQUAL>
   u32 GetPercentileBase(float score) {
     if (score == 0) {
       return 0;
     }
-    if (count_ == 0) {
+    std::lock_guard<std::mutex> lock(lock_);
+    Merge();
+    if (count_ <= 0) {
       return 100;
     }
     u32 bin = GetBin(score);
-    u32 count = 0;
-    if (LESS_THAN_EQUAL) {
-      for (u32 i = 0; i <= bin; ++i) {
-        count += histogram_[i].x_.load();
-      }
-    } else {
-      for (u32 i = 0; i < bin; ++i) {
-        count += histogram_[i].x_.load();
-      }
-    }
-    return count * 100 / count_;
-  }
-  u32 GetPercentile(float score) {
-    return GetPercentileBase<true>(score);
-  }
-  u32 GetPercentileLT(float score) {
-    return GetPercentileBase<false>(score);
+    i64 count = Prefix(LESS_THAN_EQUAL ? bin + 1 : bin);
+    return (u32)(count * 100 / count_);
   }
+  u32 GetPercentile(float score) { return GetPercentileBase<true>(score); }
+  u32 GetPercentileLT(float score) { return GetPercentileBase<false>(score); }
 
   /**
-   * Get quantile.
+   * Get the upper edge of the first bin at which percentile of the
+   * entries have been counted.
+   *
    * @input percentile is a number between 0 and 100
+   * @return a score between 0 and 1
    * */
   float GetQuantile(u32 percentile) {
-    u32 count = 0;
-    if (count_ == 0) {
+    std::lock_guard<std::mutex> lock(lock_);
+    Merge();
+    if (count_ <= 0) {
+      return 0.0;
+    }
+    // The smallest count c where c * 100 >= percentile * count_
+    i64 target = (percentile * count_ + 99) / 100;
+    if (target < 1) {
+      target = 1;
+    }
+    if (target > count_) {
       return 0.0;
     }
-    for (u32 i = 0; i < histogram_.size(); ++i) {
-      count += histogram_[i].x_.load();
-      if (count * 100 / count_ >= percentile && count > 0) {
-        return (i + 1) / histogram_.size();
+    return (float)(Search(target) + 1) / num_bins_;
+  }
+
+ private:
+  /** Record a change to a bin in the lane's shard */
+  void Update(float score, i64 delta, u32 shard) {
+    HistShard &hist_shard = shards_[shard % num_shards_];
+    hist_shard.deltas_[GetBin(score)].fetch_add(delta);
+    hist_shard.dirty_.store(true);
+  }
+
+  /** Fold the outstanding shard deltas into the tree. Holds lock_. */
+  void Merge() {
+    for (u32 i = 0; i < num_shards_; ++i) {
+      HistShard &shard = shards_[i];
+      if (!shard.dirty_.exchange(false)) {
+        continue;
+      }
+      for (u32 bin = 0; bin < num_bins_; ++bin) {
+        i64 delta = shard.deltas_[bin].exchange(0);
+        if (delta == 0) {
+          continue;
+        }
+        count_ += delta;
+        for (u32 idx = bin + 1; idx <= num_bins_; idx += idx & -idx) {
+          tree_[idx] += delta;
+        }
+      }
+    }
+  }
+
+  /** Number of entries in the bins [0, num_bins). Holds lock_. */
+  i64 Prefix(u32 num_bins) const {
+    i64 count = 0;
+    for (u32 idx = num_bins; idx > 0; idx -= idx & -idx) {
+      count += tree_[idx];
+    }
+    return count;
+  }
+
+  /** The first bin where the running count reaches target. Holds lock_. */
+  u32 Search(i64 target) const {
+    u32 pos = 0;
+    u32 step = 1;
+    while (step * 2 <= num_bins_) {
+      step *= 2;
+    }
+    for (; step > 0; step /= 2) {
+      if (pos + step <= num_bins_ && tree_[pos + step] < target) {
+        pos += step;
+        target -= tree_[pos];
       }
     }
-    return 0.0;
+    return pos;
   }
 };
 
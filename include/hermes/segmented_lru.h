@@ -0,0 +1,126 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_INCLUDE_HERMES_SEGMENTED_LRU_H_
+#define HERMES_INCLUDE_HERMES_SEGMENTED_LRU_H_
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+
+namespace hermes {
+
+/**
+ * A segmented LRU replacement order.
+ *
+ * Keys enter the probationary segment and move to the protected segment
+ * when touched again, so a single scan can't push out data that is
+ * reused. When the protected segment outgrows its share, its least
+ * recently used key drops back to probation. Victims come from the cold
+ * end of probation first. Not thread-safe.
+ * */
+template <typename KeyT>
+class SegmentedLru {
+ public:
+  typedef std::list<KeyT> LIST_T;
+
+  /** Where a key lives */
+  struct Entry {
+    typename LIST_T::iterator it_;
+    bool is_protected_;
+  };
+
+ public:
+  LIST_T probation_;  /**< Seen once, most recent at the front */
+  LIST_T protected_;  /**< Seen again, most recent at the front */
+  std::unordered_map<KeyT, Entry> map_;
+  float protected_ratio_; /**< Share of the keys the protected segment keeps */
+
+ public:
+  /** Constructor */
+  explicit SegmentedLru(float protected_ratio = .8)
+      : protected_ratio_(protected_ratio) {}
+
+  /** Record an access to \a key */
+  void Touch(const KeyT &key) {
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+      probation_.emplace_front(key);
+      map_.emplace(key, Entry{probation_.begin(), false});
+      return;
+    }
+    Entry &entry = it->second;
+    LIST_T &from = entry.is_protected_ ? protected_ : probation_;
+    protected_.splice(protected_.begin(), from, entry.it_);
+    entry.it_ = protected_.begin();
+    entry.is_protected_ = true;
+    // Keep the protected segment within its share
+    size_t max_protected =
+        std::max<size_t>(1, protected_ratio_ * map_.size());
+    while (protected_.size() > max_protected) {
+      auto cold = std::prev(protected_.end());
+      Entry &cold_entry = map_[*cold];
+      probation_.splice(probation_.begin(), protected_, cold);
+      cold_entry.it_ = probation_.begin();
+      cold_entry.is_protected_ = false;
+    }
+  }
+
+  /** Insert \a key as the next victim, unless it is already tracked */
+  void PushCold(const KeyT &key) {
+    if (map_.find(key) != map_.end()) {
+      return;
+    }
+    probation_.emplace_back(key);
+    map_.emplace(key, Entry{std::prev(probation_.end()), false});
+  }
+
+  /** Stop tracking \a key */
+  void Erase(const KeyT &key) {
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+      return;
+    }
+    Entry &entry = it->second;
+    (entry.is_protected_ ? protected_ : probation_).erase(entry.it_);
+    map_.erase(it);
+  }
+
+  /** Remove the coldest key. Returns false if nothing is tracked. */
+  bool PopVictim(KeyT &key) {
+    LIST_T &list = probation_.empty() ? protected_ : probation_;
+    if (list.empty()) {
+      return false;
+    }
+    key = list.back();
+    map_.erase(key);
+    list.pop_back();
+    return true;
+  }
+
+  /** Whether \a key is tracked */
+  bool Contains(const KeyT &key) const { return map_.find(key) != map_.end(); }
+
+  /** Whether \a key is in the protected segment */
+  bool IsProtected(const KeyT &key) const {
+    auto it = map_.find(key);
+    return it != map_.end() && it->second.is_protected_;
+  }
+
+  /** Number of tracked keys */
+  size_t size() const { return map_.size(); }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_INCLUDE_HERMES_SEGMENTED_LRU_H_
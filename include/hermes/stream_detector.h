@@ -0,0 +1,73 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_INCLUDE_HERMES_STREAM_DETECTOR_H_
+#define HERMES_INCLUDE_HERMES_STREAM_DETECTOR_H_
+
+#include <chimaera/chimaera_types.h>
+
+namespace hermes {
+
+/**
+ * Detects scan-once and write-once streams over the blobs of a tag.
+ *
+ * Each access either touches a blob for the first time (a new blob or
+ * one just staged in) or reuses a blob. A long enough run of first
+ * touches is a stream. A reuse halves the run, so an occasional hit on
+ * hot data does not end a scan, but steady reuse does. Repeated accesses
+ * to the blob accessed last (e.g., small writes filling a page) are
+ * neither.
+ * */
+template <typename KeyT>
+class StreamDetector {
+ public:
+  KeyT last_;        /**< The blob accessed last */
+  bool has_last_;    /**< Whether last_ is set */
+  u32 run_;          /**< First touches in the current run */
+  u32 min_run_;      /**< First touches before the tag is a stream */
+
+ public:
+  /** Constructor */
+  explicit StreamDetector(u32 min_run = 32)
+      : has_last_(false), run_(0), min_run_(min_run) {}
+
+  /**
+   * Record an access to \a key.
+   *
+   * @return whether the tag is being accessed as a stream
+   * */
+  bool Record(const KeyT &key, bool first_touch) {
+    if (IsLast(key)) {
+      return IsStream();
+    }
+    last_ = key;
+    has_last_ = true;
+    if (first_touch) {
+      if (run_ < min_run_) {
+        ++run_;
+      }
+    } else {
+      run_ /= 2;
+    }
+    return IsStream();
+  }
+
+  /** Whether \a key was the last blob accessed */
+  bool IsLast(const KeyT &key) const { return has_last_ && last_ == key; }
+
+  /** Whether the tag is being accessed as a stream */
+  bool IsStream() const { return min_run_ > 0 && run_ >= min_run_; }
+};
+
+}  // namespace hermes
+
+#endif  // HERMES_INCLUDE_HERMES_STREAM_DETECTOR_H_
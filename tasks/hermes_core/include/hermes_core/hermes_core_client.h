@@ -179,12 +179,14 @@ class Client : public ModuleClient {
   CHI_END(TagGetContainedBlobIds)
 
   CHI_BEGIN(TagFlush)
-  /** Flush tag */
-  void TagFlush(const hipc::MemContext &mctx, const DomainQuery &dom_query,
+  /** Flush tag. Returns false if a blob or the backend sync failed. */
+  bool TagFlush(const hipc::MemContext &mctx, const DomainQuery &dom_query,
                 const TagId &tag_id) {
     FullPtr<TagFlushTask> task = AsyncTagFlush(mctx, dom_query, tag_id);
     task->Wait();
+    bool ok = task->ok_;
     CHI_CLIENT->DelTask(mctx, task);
+    return ok;
   }
   CHI_TASK_METHODS(TagFlush);
   CHI_END(TagFlush)
@@ -416,12 +418,14 @@ class Client : public ModuleClient {
   CHI_END(DestroyBlob)
 
   CHI_BEGIN(FlushBlob)
-  /** FlushBlob task */
-  void FlushBlob(const hipc::MemContext &mctx, const DomainQuery &dom_query,
+  /** FlushBlob task. Returns false if the blob couldn't be flushed. */
+  bool FlushBlob(const hipc::MemContext &mctx, const DomainQuery &dom_query,
                  const BlobId &blob_id) {
     FullPtr<FlushBlobTask> task = AsyncFlushBlob(mctx, dom_query, blob_id);
     task->Wait();
+    bool ok = task->ok_;
     CHI_CLIENT->DelTask(mctx, task);
+    return ok;
   }
   CHI_TASK_METHODS(FlushBlob);
   CHI_END(FlushBlob)
@@ -429,8 +433,8 @@ class Client : public ModuleClient {
   CHI_BEGIN(FlushData)
   /** FlushData task */
   void FlushData(const hipc::MemContext &mctx, const DomainQuery &dom_query,
-                 int period_sec = 5) {
-    FullPtr<FlushDataTask> task = AsyncFlushData(mctx, dom_query, period_sec);
+                 size_t period_ms = 1024) {
+    FullPtr<FlushDataTask> task = AsyncFlushData(mctx, dom_query, period_ms);
     task->Wait();
     CHI_CLIENT->DelTask(mctx, task);
   }
@@ -558,6 +562,32 @@ class Client : public ModuleClient {
   CHI_TASK_METHODS(StageOut);
   CHI_END(StageOut)
 
+  CHI_BEGIN(Prestage)
+  /** Prestage task */
+  void Prestage(const hipc::MemContext &mctx, const DomainQuery &dom_query,
+                const BucketId &bkt_id, size_t off, size_t size,
+                float score) {
+    FullPtr<PrestageTask> task =
+        AsyncPrestage(mctx, dom_query, bkt_id, off, size, score);
+    task->Wait();
+    CHI_CLIENT->DelTask(mctx, task);
+  }
+  CHI_TASK_METHODS(Prestage);
+  CHI_END(Prestage)
+
+  CHI_BEGIN(SyncStager)
+  /** SyncStager task. Returns false if the backend couldn't be synced. */
+  bool SyncStager(const hipc::MemContext &mctx, const DomainQuery &dom_query,
+                  const BucketId &bkt_id) {
+    FullPtr<SyncStagerTask> task = AsyncSyncStager(mctx, dom_query, bkt_id);
+    task->Wait();
+    bool ok = task->ok_;
+    CHI_CLIENT->DelTask(mctx, task);
+    return ok;
+  }
+  CHI_TASK_METHODS(SyncStager);
+  CHI_END(SyncStager)
+
   CHI_AUTOGEN_METHODS
 };
 
@@ -148,6 +148,14 @@ void Run(u32 method, Task *task, RunContext &rctx) override {
       StageOut(reinterpret_cast<StageOutTask *>(task), rctx);
       break;
     }
+    case Method::kPrestage: {
+      Prestage(reinterpret_cast<PrestageTask *>(task), rctx);
+      break;
+    }
+    case Method::kSyncStager: {
+      SyncStager(reinterpret_cast<SyncStagerTask *>(task), rctx);
+      break;
+    }
   }
 }
 /** Execute a task */
@@ -297,6 +305,14 @@ void Monitor(MonitorModeId mode, MethodId method, Task *task, RunContext &rctx)
       MonitorStageOut(mode, reinterpret_cast<StageOutTask *>(task), rctx);
       break;
     }
+    case Method::kPrestage: {
+      MonitorPrestage(mode, reinterpret_cast<PrestageTask *>(task), rctx);
+      break;
+    }
+    case Method::kSyncStager: {
+      MonitorSyncStager(mode, reinterpret_cast<SyncStagerTask *>(task), rctx);
+      break;
+    }
   }
 }
 /** Delete a task */
@@ -446,6 +462,14 @@ void Del(const hipc::MemContext &mctx, u32 method, Task *task) override {
       CHI_CLIENT->DelTask<StageOutTask>(mctx, reinterpret_cast<StageOutTask *>(task));
       break;
     }
+    case Method::kPrestage: {
+      CHI_CLIENT->DelTask<PrestageTask>(mctx, reinterpret_cast<PrestageTask *>(task));
+      break;
+    }
+    case Method::kSyncStager: {
+      CHI_CLIENT->DelTask<SyncStagerTask>(mctx, reinterpret_cast<SyncStagerTask *>(task));
+      break;
+    }
   }
 }
 /** Duplicate a task */
@@ -667,6 +691,18 @@ void CopyStart(u32 method, const Task *orig_task, Task *dup_task, bool deep) ove
         reinterpret_cast<StageOutTask*>(dup_task), deep);
       break;
     }
+    case Method::kPrestage: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const PrestageTask*>(orig_task), 
+        reinterpret_cast<PrestageTask*>(dup_task), deep);
+      break;
+    }
+    case Method::kSyncStager: {
+      chi::CALL_COPY_START(
+        reinterpret_cast<const SyncStagerTask*>(orig_task), 
+        reinterpret_cast<SyncStagerTask*>(dup_task), deep);
+      break;
+    }
   }
 }
 /** Duplicate a task */
@@ -816,6 +852,14 @@ void NewCopyStart(u32 method, const Task *orig_task, FullPtr<Task> &dup_task, bo
       chi::CALL_NEW_COPY_START(reinterpret_cast<const StageOutTask*>(orig_task), dup_task, deep);
       break;
     }
+    case Method::kPrestage: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const PrestageTask*>(orig_task), dup_task, deep);
+      break;
+    }
+    case Method::kSyncStager: {
+      chi::CALL_NEW_COPY_START(reinterpret_cast<const SyncStagerTask*>(orig_task), dup_task, deep);
+      break;
+    }
   }
 }
 /** Serialize a task when initially pushing into remote */
@@ -967,6 +1011,18 @@ void SaveStart(
       ar << *reinterpret_cast<StageOutTask*>(task);
       break;
     }
+    case Method::kPrestage: {
+      ar << *reinterpret_cast<PrestageTask*>(task);
+      break;
+    }
+    case Method::kSyncStager: {
+      ar << *reinterpret_cast<SyncStagerTask*>(task);
+      break;
+    }
+    case Method::kSyncStager: {
+      ar << *reinterpret_cast<SyncStagerTask*>(task);
+      break;
+    }
   }
 }
 /** Deserialize a task when popping from remote queue */
@@ -1189,6 +1245,18 @@ TaskPointer LoadStart(    u32 method, BinaryInputArchive<true> &ar) override {
       ar >> *reinterpret_cast<StageOutTask*>(task_ptr.ptr_);
       break;
     }
+    case Method::kPrestage: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<PrestageTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<PrestageTask*>(task_ptr.ptr_);
+      break;
+    }
+    case Method::kSyncStager: {
+      task_ptr.ptr_ = CHI_CLIENT->NewEmptyTask<SyncStagerTask>(
+             HSHM_DEFAULT_MEM_CTX, task_ptr.shm_);
+      ar >> *reinterpret_cast<SyncStagerTask*>(task_ptr.ptr_);
+      break;
+    }
   }
   return task_ptr;
 }
@@ -1339,6 +1407,10 @@ void SaveEnd(u32 method, BinaryOutputArchive<false> &ar, Task *task) override {
       ar << *reinterpret_cast<StageOutTask*>(task);
       break;
     }
+    case Method::kPrestage: {
+      ar << *reinterpret_cast<PrestageTask*>(task);
+      break;
+    }
   }
 }
 /** Deserialize a task when popping from remote queue */
@@ -1488,6 +1560,14 @@ void LoadEnd(u32 method, BinaryInputArchive<false> &ar, Task *task) override {
       ar >> *reinterpret_cast<StageOutTask*>(task);
       break;
     }
+    case Method::kPrestage: {
+      ar >> *reinterpret_cast<PrestageTask*>(task);
+      break;
+    }
+    case Method::kSyncStager: {
+      ar >> *reinterpret_cast<SyncStagerTask*>(task);
+      break;
+    }
   }
 }
 
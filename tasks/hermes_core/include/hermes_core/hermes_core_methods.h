@@ -37,7 +37,9 @@ struct Method : public TaskMethod {
   TASK_METHOD_T kUnregisterStager = 61;
   TASK_METHOD_T kStageIn = 62;
   TASK_METHOD_T kStageOut = 63;
-  TASK_METHOD_T kCount = 64;
+  TASK_METHOD_T kPrestage = 64;
+  TASK_METHOD_T kSyncStager = 65;
+  TASK_METHOD_T kCount = 66;
 };
 
 #endif  // CHI_HERMES_CORE_METHODS_H_
\ No newline at end of file
@@ -593,6 +593,7 @@ CHI_BEGIN(TagFlush)
 /** The TagFlushTask task */
 struct TagFlushTask : public Task, TaskFlags<TF_SRL_SYM>, TagWithId {
   IN TagId tag_id_;
+  OUT bool ok_; /**< Whether the blobs were flushed and the backend synced */
 
   /** SHM default constructor */
   HSHM_INLINE explicit TagFlushTask(
@@ -614,18 +615,26 @@ struct TagFlushTask : public Task, TaskFlags<TF_SRL_SYM>, TagWithId {
 
     // Custom
     tag_id_ = tag_id;
+    ok_ = true;
   }
 
   /** Duplicate message */
-  void CopyStart(const TagFlushTask &other, bool deep) {}
+  void CopyStart(const TagFlushTask &other, bool deep) {
+    tag_id_ = other.tag_id_;
+    ok_ = other.ok_;
+  }
 
   /** (De)serialize message call */
   template <typename Ar>
-  void SerializeStart(Ar &ar) {}
+  void SerializeStart(Ar &ar) {
+    ar(tag_id_);
+  }
 
   /** (De)serialize message return */
   template <typename Ar>
-  void SerializeEnd(Ar &ar) {}
+  void SerializeEnd(Ar &ar) {
+    ar(ok_);
+  }
 };
 CHI_END(TagFlush)
 
@@ -645,6 +654,11 @@ CHI_END(TagFlush)
 #define HERMES_GET_BLOB_ID BIT_OPT(u32, 7)
 #define HERMES_HAS_DERIVED BIT_OPT(u32, 8)
 #define HERMES_USER_SCORE_STATIONARY BIT_OPT(u32, 9)
+#define HERMES_BLOB_IS_REORGANIZING BIT_OPT(u32, 10)
+#define HERMES_BLOB_IS_DIRTY BIT_OPT(u32, 11)
+#define HERMES_BACKGROUND_IO BIT_OPT(u32, 12)
+#define HERMES_BLOB_IS_STREAMED BIT_OPT(u32, 13)
+#define HERMES_STAGE_DIRECT_IO BIT_OPT(u32, 14)
 
 CHI_BEGIN(GetOrCreateBlobId)
 /**
@@ -1182,7 +1196,7 @@ struct ReorganizeBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithId {
   /** (De)serialize message call */
   template <typename Ar>
   void SerializeStart(Ar &ar) {
-    ar(tag_id_, blob_name_, blob_id_, score_, node_id_);
+    ar(tag_id_, blob_name_, blob_id_, score_, node_id_, is_user_score_);
   }
 
   /** (De)serialize message return */
@@ -1195,6 +1209,7 @@ CHI_BEGIN(FlushBlob)
 /** The FlushBlobTask task */
 struct FlushBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithId {
   IN BlobId blob_id_;
+  OUT bool ok_; /**< Whether the blob was flushed */
 
   /** SHM default constructor */
   HSHM_INLINE explicit FlushBlobTask(
@@ -1217,18 +1232,26 @@ struct FlushBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithId {
 
     // Custom
     blob_id_ = blob_id;
+    ok_ = true;
   }
 
   /** Duplicate message */
-  void CopyStart(const FlushBlobTask &other, bool deep) {}
+  void CopyStart(const FlushBlobTask &other, bool deep) {
+    blob_id_ = other.blob_id_;
+    ok_ = other.ok_;
+  }
 
   /** (De)serialize message call */
   template <typename Ar>
-  void SerializeStart(Ar &ar) {}
+  void SerializeStart(Ar &ar) {
+    ar(blob_id_);
+  }
 
   /** (De)serialize message return */
   template <typename Ar>
-  void SerializeEnd(Ar &ar) {}
+  void SerializeEnd(Ar &ar) {
+    ar(ok_);
+  }
 };
 CHI_END(FlushBlob)
 
@@ -1295,6 +1318,9 @@ struct PutBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithIdAndName {
   IN hipc::Pointer data_;
   IN float score_;
   IN bitfield32_t flags_;
+  IN PlacementPolicy dpe_;
+  IN PlacementObjective objective_;
+  IN u32 access_node_id_;
 
   /** SHM default constructor */
   HSHM_INLINE explicit PutBlobTask(const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
@@ -1324,6 +1350,9 @@ struct PutBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithIdAndName {
     data_ = data;
     score_ = score;
     flags_ = bitfield32_t(hermes_flags | ctx.flags_.bits_);
+    dpe_ = ctx.dpe_;
+    objective_ = ctx.objective_;
+    access_node_id_ = ctx.node_id_;
   }
 
   /** Destructor */
@@ -1345,12 +1374,16 @@ struct PutBlobTask : public Task, TaskFlags<TF_SRL_SYM>, BlobWithIdAndName {
     data_ = other.data_;
     score_ = other.score_;
     flags_ = other.flags_;
+    dpe_ = other.dpe_;
+    objective_ = other.objective_;
+    access_node_id_ = other.access_node_id_;
   }
 
   /** (De)serialize message call */
   template <typename Ar>
   void SerializeStart(Ar &ar) {
-    ar(tag_id_, blob_name_, blob_id_, blob_off_, data_size_, score_, flags_);
+    ar(tag_id_, blob_name_, blob_id_, blob_off_, data_size_, score_, flags_,
+       dpe_, objective_, access_node_id_);
     ar.bulk(DT_WRITE, data_, data_size_);
   }
 
@@ -1461,7 +1494,7 @@ struct FlushDataTask : public Task, TaskFlags<TF_SRL_SYM> {
   /** Emplace constructor */
   HSHM_INLINE explicit FlushDataTask(
       const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
-      const PoolId &pool_id, const DomainQuery &dom_query, int period_sec)
+      const PoolId &pool_id, const DomainQuery &dom_query, size_t period_ms)
       : Task(alloc) {
     // Initialize task
     task_node_ = task_node;
@@ -1470,7 +1503,7 @@ struct FlushDataTask : public Task, TaskFlags<TF_SRL_SYM> {
     method_ = Method::kFlushData;
     task_flags_.SetBits(TASK_LONG_RUNNING);
     dom_query_ = dom_query;
-    SetPeriodSec(period_sec);
+    SetPeriodMs(period_ms);
 
     // Custom
   }
@@ -1828,6 +1861,129 @@ struct StageOutTask : public Task, TaskFlags<TF_SRL_SYM> {
 };
 CHI_END(StageOut)
 
+CHI_BEGIN(Prestage)
+/** The PrestageTask task */
+struct PrestageTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN hermes::BucketId bkt_id_;
+  IN size_t off_;
+  IN size_t size_; /**< 0 means up to the end of the backend */
+  IN float score_;
+  OUT hipc::atomic<size_t> staged_; /**< Blobs put into hermes so far */
+  OUT size_t total_;               /**< Blobs in the range */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit PrestageTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit PrestageTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const BucketId &bkt_id, size_t off, size_t size, float score)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kPrestage;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    bkt_id_ = bkt_id;
+    off_ = off;
+    size_ = size;
+    score_ = score;
+    staged_ = 0;
+    total_ = 0;
+  }
+
+  /**
+   * Fraction of the range's blobs staged in so far. Blobs that could not
+   * be read are never counted, so a failed prestage stays below 1.
+   * */
+  float GetProgress() const {
+    if (total_ == 0) {
+      return 0;
+    }
+    return (float)staged_.load() / total_;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const PrestageTask &other, bool deep) {
+    bkt_id_ = other.bkt_id_;
+    off_ = other.off_;
+    size_ = other.size_;
+    score_ = other.score_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(bkt_id_, off_, size_, score_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    size_t staged = staged_.load();
+    ar(staged, total_);
+    staged_ = staged;
+  }
+};
+CHI_END(Prestage)
+
+CHI_BEGIN(SyncStager)
+/** The SyncStagerTask task */
+struct SyncStagerTask : public Task, TaskFlags<TF_SRL_SYM> {
+  IN hermes::BucketId bkt_id_;
+  OUT bool ok_; /**< Whether the stager's backend was synced */
+
+  /** SHM default constructor */
+  HSHM_INLINE explicit SyncStagerTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc)
+      : Task(alloc) {}
+
+  /** Emplace constructor */
+  HSHM_INLINE explicit SyncStagerTask(
+      const hipc::CtxAllocator<CHI_ALLOC_T> &alloc, const TaskNode &task_node,
+      const PoolId &pool_id, const DomainQuery &dom_query,
+      const BucketId &bkt_id)
+      : Task(alloc) {
+    // Initialize task
+    task_node_ = task_node;
+    prio_ = TaskPrioOpt::kLowLatency;
+    pool_ = pool_id;
+    method_ = Method::kSyncStager;
+    task_flags_.SetBits(0);
+    dom_query_ = dom_query;
+
+    // Custom
+    bkt_id_ = bkt_id;
+    ok_ = true;
+  }
+
+  /** Duplicate message */
+  void CopyStart(const SyncStagerTask &other, bool deep) {
+    bkt_id_ = other.bkt_id_;
+    ok_ = other.ok_;
+  }
+
+  /** (De)serialize message call */
+  template <typename Ar>
+  void SerializeStart(Ar &ar) {
+    ar(bkt_id_);
+  }
+
+  /** (De)serialize message return */
+  template <typename Ar>
+  void SerializeEnd(Ar &ar) {
+    ar(ok_);
+  }
+};
+CHI_END(SyncStager)
+
 CHI_AUTOGEN_METHODS
 }  // namespace hermes
 
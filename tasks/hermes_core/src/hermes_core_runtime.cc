@@ -10,7 +10,9 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <limits>
 #include <string>
+#include <unordered_set>
 
 #include "bdev/bdev_client.h"
 #include "chimaera/api/chimaera_runtime.h"
@@ -18,9 +20,14 @@
 #include "chimaera/monitor/monitor.h"
 #include "chimaera/work_orchestrator/work_orchestrator.h"
 #include "chimaera_admin/chimaera_admin_client.h"
+#include "hermes/compressor.h"
 #include "hermes/data_stager/stager_factory.h"
 #include "hermes/dpe/dpe_factory.h"
 #include "hermes/hermes.h"
+#include "hermes/rcu_map.h"
+#include "hermes/score_histogram.h"
+#include "hermes/segmented_lru.h"
+#include "hermes/stream_detector.h"
 #include "hermes_core/hermes_core_client.h"
 
 /** NOTE(llogan): std::hash function for string. This is because NVCC is bugged
@@ -39,24 +46,40 @@ namespace hermes {
 struct FlushInfo {
   BlobInfo *blob_info_;
   FullPtr<StageOutTask> stage_task_;
+  FullPtr<GetBlobTask> get_task_;
+  FullPtr<char> data_;
+  size_t blob_off_;
+  size_t size_; /**< Size of the dirty range at blob_off_ */
   size_t mod_count_;
 };
 
+/** A stage-in in progress. Accesses to the blob wait until it is done. */
+struct StageInFlight {
+  std::atomic<bool> done_{false};
+};
+
 /** Type name simplification for the various map types */
 typedef std::unordered_map<chi::string, TagId> TAG_ID_MAP_T;
 typedef std::unordered_map<TagId, TagInfo> TAG_MAP_T;
 typedef std::unordered_map<chi::string, BlobId> BLOB_ID_MAP_T;
 typedef std::unordered_map<BlobId, BlobInfo> BLOB_MAP_T;
 typedef hipc::circular_mpsc_queue<IoStat> IO_PATTERN_LOG_T;
-typedef std::unordered_map<TagId, std::shared_ptr<AbstractStager>> STAGER_MAP_T;
+typedef RcuMap<TagId, std::shared_ptr<AbstractStager>> STAGER_MAP_T;
 
 struct HermesLane {
   TAG_ID_MAP_T tag_id_map_;
   TAG_MAP_T tag_map_;
   BLOB_ID_MAP_T blob_id_map_;
   BLOB_MAP_T blob_map_;
-  STAGER_MAP_T stager_map_;
-  chi::CoMutex stager_map_lock_;
+  std::list<BlobId> dirty_blobs_; /**< Staged blobs modified since flush */
+  SegmentedLru<BlobId> clean_blobs_; /**< Staged blobs in eviction order */
+  std::unordered_map<TagId, StreamDetector<BlobId>> streams_;
+  /** Blobs being staged in */
+  std::unordered_map<BlobId, std::shared_ptr<StageInFlight>> stage_ins_;
+  chi::CoMutex dirty_blobs_lock_;
+  chi::CoMutex clean_blobs_lock_;
+  chi::CoMutex streams_lock_;
+  chi::CoMutex stage_ins_lock_;
   chi::CoRwLock tag_map_lock_;
   chi::CoRwLock blob_map_lock_;
 };
@@ -64,14 +87,30 @@ struct HermesLane {
 class Server : public Module {
  public:
   CLS_CONST LaneGroupId kDefaultGroup = 0;
+  /** How far a blob's rank must leave its tier's band before it moves */
+  CLS_CONST float kReorgMargin = .05;
+  /** First touches in a row before a tag is treated as a stream */
+  CLS_CONST u32 kStreamMinRun = 32;
+  /** Blobs a prestage reads from the backend at a time */
+  CLS_CONST size_t kPrestageBatch = 64;
   Client client_;
   std::vector<HermesLane> tls_;
   std::atomic<u64> id_alloc_;
   std::vector<TargetInfo> targets_;
   std::unordered_map<TargetId, TargetInfo *> target_map_;
+  std::list<SlabStats> slab_stats_;
+  std::list<TargetIoStats> target_io_stats_;
   chi::RollingAverage monitor_[Method::kCount];
   IO_PATTERN_LOG_T io_pattern_;
+  /** Stagers by tag. Node-wide, since lanes share the tags. */
+  STAGER_MAP_T stager_map_;
   TargetInfo *fallback_target_;
+  Histogram score_hist_;
+  hshm::Timepoint last_reorg_;
+  std::atomic<size_t> dirty_bytes_{0}; /**< Bytes awaiting stage-out */
+  double flush_tokens_ = 0; /**< Bytes flushing may write (token bucket) */
+  std::atomic<size_t> spilled_bytes_{0}; /**< Bytes spilled to fallback */
+  hshm::Timepoint last_sweep_;
 
  private:
   /** Get the globally unique blob name */
@@ -92,6 +131,9 @@ class Server : public Module {
     CreateLaneGroup(kDefaultGroup, HERMES_LANES, QUEUE_LOW_LATENCY);
     tls_.resize(HERMES_LANES);
     io_pattern_.resize(8192);
+    score_hist_.Resize(100, HERMES_LANES);
+    last_reorg_.Now();
+    last_sweep_.Now();
     // Create block devices
     targets_.reserve(
         128);  // TODO(llogan): Calculate number of buffering devices
@@ -117,6 +159,15 @@ class Server : public Module {
         continue;
       }
       HILOG(kInfo, "Created target: {}", target.id_);
+      slab_stats_.emplace_back();
+      slab_stats_.back().Init(dev.slab_sizes_);
+      target.slabs_ = &slab_stats_.back();
+      target_io_stats_.emplace_back();
+      target.io_stats_ = &target_io_stats_.back();
+      target.io_stats_->idle_since_.Now();
+      target.borg_min_thresh_ = dev.borg_min_thresh_;
+      target.borg_max_thresh_ = dev.borg_max_thresh_;
+      target.codec_ = (u8)Compressor::FromString(dev.compress_);
       target.poll_stats_ = target.client_.AsyncPollStats(
           HSHM_MCTX,
           chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
@@ -132,11 +183,12 @@ class Server : public Module {
     }
     // }
     fallback_target_ = &targets_.back();
+    RankTargets();
     // Create flushing task
     client_.AsyncFlushData(
         HSHM_MCTX,
         chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
-        5);  // OK
+        HERMES_SERVER_CONF.borg_.flush_period_);  // OK
   }
   void MonitorCreate(MonitorModeId mode, CreateTask *task, RunContext &rctx) {}
   CHI_END(Create)
@@ -446,6 +498,10 @@ class Server : public Module {
       client_.UnregisterStager(HSHM_MCTX, chi::DomainQuery::GetGlobalBcast(),
                                task->tag_id_);  // OK
     }
+    {
+      chi::ScopedCoMutex streams_lock(tls.streams_lock_);
+      tls.streams_.erase(task->tag_id_);
+    }
     // Remove tag from maps
     TAG_ID_MAP_T &tag_id_map = tls.tag_id_map_;
     tag_id_map.erase(tag.name_);
@@ -633,7 +689,11 @@ class Server : public Module {
   CHI_END(TagGetContainedBlobIds)
 
   CHI_BEGIN(TagFlush)
-  /** Flush tag */
+  /**
+   * Flush the dirty blobs of a tag in parallel, wait for all of them, and
+   * then sync the tag's backend on every node so the flushed data is
+   * durable.
+   * */
   void TagFlush(TagFlushTask *task, RunContext &rctx) {
     HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
     chi::ScopedCoRwReadLock tag_map_lock(tls.tag_map_lock_);
@@ -642,18 +702,880 @@ class Server : public Module {
     if (it == tag_map.end()) {
       return;
     }
-    TagInfo &tag = it->second;
-    for (BlobId &blob_id : tag.blobs_) {
-      client_.FlushBlob(HSHM_MCTX,
-                        chi::DomainQuery::GetDirectHash(
-                            chi::SubDomainId::kLocalContainers, 0),
-                        blob_id);  // TODO(llogan): route
+    TagInfo &tag = it->second;
+    std::vector<FullPtr<FlushBlobTask>> flush_tasks;
+    flush_tasks.reserve(tag.blobs_.size());
+    {
+      chi::ScopedCoRwReadLock blob_map_lock(tls.blob_map_lock_);
+      for (BlobId &blob_id : tag.blobs_) {
+        // Skip blobs known to be clean
+        auto blob_it = tls.blob_map_.find(blob_id);
+        if (blob_it != tls.blob_map_.end() &&
+            blob_it->second.mod_count_ <= blob_it->second.last_flush_) {
+          continue;
+        }
+        flush_tasks.emplace_back(client_.AsyncFlushBlob(
+            HSHM_MCTX,
+            chi::DomainQuery::GetDirectHash(
+                chi::SubDomainId::kGlobalContainers,
+                HashBlobNameOrId(task->tag_id_, std::string(), blob_id)),
+            blob_id));
+      }
+    }
+    task->Wait(flush_tasks);
+    for (FullPtr<FlushBlobTask> &flush_task : flush_tasks) {
+      task->ok_ &= flush_task->ok_;
+      CHI_CLIENT->DelTask(HSHM_MCTX, flush_task);
+    }
+    // Blobs are flushed by the nodes that own them, so sync them all
+    FullPtr<SyncStagerTask> sync_task = client_.AsyncSyncStager(
+        HSHM_MCTX, chi::DomainQuery::GetGlobalBcast(), task->tag_id_);
+    task->Wait(sync_task);
+    task->ok_ &= sync_task->ok_;
+    CHI_CLIENT->DelTask(HSHM_MCTX, sync_task);
+  }
+  void MonitorTagFlush(MonitorModeId mode, TagFlushTask *task,
+                       RunContext &rctx) {}
+  CHI_END(TagUpdateSize)
+
+  /**
+   * ========================================
+   * SCORE Methods
+   * ========================================
+   * */
+
+  /**
+   * Score targets by write bandwidth. Targets of equal bandwidth form a
+   * tier. With n tiers, the i-th slowest tier gets score i / n, so blobs
+   * scored in [i / n, (i + 1) / n) belong to it.
+   * */
+  void RankTargets() {
+    std::vector<float> tiers;
+    tiers.reserve(targets_.size());
+    for (TargetInfo &target : targets_) {
+      tiers.emplace_back(target.stats_->write_bw_);
+    }
+    std::sort(tiers.begin(), tiers.end());
+    tiers.erase(std::unique(tiers.begin(), tiers.end()), tiers.end());
+    for (TargetInfo &target : targets_) {
+      size_t tier = std::lower_bound(tiers.begin(), tiers.end(),
+                                     target.stats_->write_bw_) -
+                    tiers.begin();
+      target.score_ = (float)tier / tiers.size();
+      HILOG(kInfo, "Target {} has score {}", target.id_, target.score_);
+    }
+  }
+
+  /** Get the score of the fastest tier a blob of \a score may use */
+  float GetTierScore(float score) {
+    float tier_score = 0;
+    for (TargetInfo &target : targets_) {
+      if (target.score_ <= score && target.score_ > tier_score) {
+        tier_score = target.score_;
+      }
+    }
+    return tier_score;
+  }
+
+  /** Get the score of the next faster tier (> 1 if there is none) */
+  float GetNextTierScore(float tier_score) {
+    float next_score = 2;
+    for (TargetInfo &target : targets_) {
+      if (target.score_ > tier_score && target.score_ < next_score) {
+        next_score = target.score_;
+      }
+    }
+    return next_score;
+  }
+
+  /** Get the score of the next slower tier (< 0 if there is none) */
+  float GetPrevTierScore(float tier_score) {
+    float prev_score = -1;
+    for (TargetInfo &target : targets_) {
+      if (target.score_ < tier_score && target.score_ > prev_score) {
+        prev_score = target.score_;
+      }
+    }
+    return prev_score;
+  }
+
+  /** Whether a local target of a tier can take \a size bytes and stay
+   * under its max watermark */
+  bool TierHasRoom(float tier_score, size_t size) {
+    for (TargetInfo &target : targets_) {
+      if (target.score_ != tier_score ||
+          target.id_.node_id_ != CHI_CLIENT->node_id_) {
+        continue;
+      }
+      float max_used = target.borg_max_thresh_ * target.stats_->max_cap_;
+      float used = target.stats_->max_cap_ - target.GetRemCap();
+      if (used + size <= max_used) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** Clamp a score to [0, 1] */
+  static float ClampScore(float score) {
+    return std::min(std::max(score, 0.0f), 1.0f);
+  }
+
+  /**
+   * Score a blob by how frequently it was accessed this epoch and how
+   * recently it was last accessed. The more important of the two wins.
+   * */
+  float MakeScore(BlobInfo &blob_info, hshm::Timepoint &now) {
+    BorgInfo &borg = HERMES_SERVER_CONF.borg_;
+    float freq_score = 0;
+    float freq_range = borg.freq_max_ - borg.freq_min_;
+    if (freq_range > 0) {
+      freq_score =
+          ((float)blob_info.access_freq_.load() - borg.freq_min_) / freq_range;
+    }
+    float rec_score = 0;
+    float rec_range = borg.recency_max_ - borg.recency_min_;
+    if (rec_range > 0) {
+      float elapsed = (float)blob_info.last_access_.GetSecFromStart(now);
+      rec_score = 1 - (elapsed - borg.recency_min_) / rec_range;
+    }
+    return std::max(ClampScore(freq_score), ClampScore(rec_score));
+  }
+
+  /** Change the score of a blob and keep the score histogram in sync */
+  void SetBlobScore(BlobInfo &blob_info, float score) {
+    u32 lane_id = CHI_CUR_LANE->lane_id_;
+    score_hist_.Decrement(blob_info.score_, lane_id);
+    blob_info.score_ = score;
+    score_hist_.Increment(blob_info.score_, lane_id);
+  }
+
+  /**
+   * Record an access to a blob in its tag's stream detector. Reusing a
+   * blob that was placed as part of a stream makes it eligible for
+   * promotion again.
+   *
+   * @return whether the tag is being accessed as a stream
+   * */
+  bool RecordAccess(HermesLane &tls, const TagId &tag_id,
+                    BlobInfo &blob_info, bool first_touch) {
+    chi::ScopedCoMutex streams_lock(tls.streams_lock_);
+    auto it = tls.streams_.find(tag_id);
+    if (it == tls.streams_.end()) {
+      it = tls.streams_
+               .emplace(tag_id, StreamDetector<BlobId>(kStreamMinRun))
+               .first;
+    }
+    StreamDetector<BlobId> &stream = it->second;
+    if (!first_touch && !stream.IsLast(blob_info.blob_id_)) {
+      blob_info.flags_.UnsetBits(HERMES_BLOB_IS_STREAMED);
+    }
+    return stream.Record(blob_info.blob_id_, first_touch);
+  }
+
+  /**
+   * Whether a staged-in blob fills the access of a stream. Stage-ins
+   * aren't accesses themselves, so prestaging a file doesn't look like
+   * a scan, but a lazy stage-in follows the access that caused it.
+   * */
+  bool IsStreamFill(HermesLane &tls, const TagId &tag_id,
+                    BlobInfo &blob_info) {
+    chi::ScopedCoMutex streams_lock(tls.streams_lock_);
+    auto it = tls.streams_.find(tag_id);
+    if (it == tls.streams_.end()) {
+      return false;
+    }
+    StreamDetector<BlobId> &stream = it->second;
+    return stream.IsLast(blob_info.blob_id_) && stream.IsStream();
+  }
+
+  /**
+   * Whether a blob of percentile \a rank should move to another tier.
+   * Blobs only move once \a rank leaves the band of their current tier
+   * by more than kReorgMargin, so blobs near a boundary don't thrash.
+   * */
+  bool ShouldReorganize(BlobInfo &blob_info, float rank) {
+    if (!IsMovable(blob_info)) {
+      return false;
+    }
+    auto it = target_map_.find(blob_info.buffers_[0].tid_);
+    if (it == target_map_.end()) {
+      return false;
+    }
+    float tier_score = it->second->score_;
+    float next_score = GetNextTierScore(tier_score);
+    if (tier_score > 0 && rank < tier_score - kReorgMargin) {
+      return true;
+    }
+    if (next_score <= 1 && rank >= next_score + kReorgMargin &&
+        !blob_info.flags_.Any(HERMES_BLOB_IS_STREAMED) &&
+        TierHasRoom(GetTierScore(rank), blob_info.blob_size_)) {
+      return true;
+    }
+    return false;
+  }
+
+  /** Migrate a blob to the tier of \a score in the background */
+  void MoveBlob(BlobInfo &blob_info, float score) {
+    HILOG(kDebug, "Moving blob {} (score={}, placement score={})",
+          blob_info.blob_id_, blob_info.score_, score);
+    blob_info.flags_.SetBits(HERMES_BLOB_IS_REORGANIZING);
+    client_.AsyncReorganizeBlob(
+        HSHM_MCTX,
+        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
+        blob_info.tag_id_, chi::string(""), blob_info.blob_id_, score, false,
+        Context());  // OK
+  }
+
+  /** Whether the BORG may move a blob */
+  static bool IsMovable(BlobInfo &blob_info) {
+    return !blob_info.buffers_.empty() &&
+           !blob_info.flags_.Any(HERMES_USER_SCORE_STATIONARY |
+                                 HERMES_BLOB_IS_REORGANIZING);
+  }
+
+  /**
+   * Rescore every blob on the lane and migrate the blobs whose rank
+   * no longer matches their tier. Migrations run in the background.
+   * */
+  void ReorganizeBlobs(BLOB_MAP_T &blob_map, hshm::Timepoint &now) {
+    // Update blob scores
+    for (auto &it : blob_map) {
+      BlobInfo &blob_info = it.second;
+      if (!blob_info.flags_.Any(HERMES_USER_SCORE_STATIONARY)) {
+        SetBlobScore(blob_info, MakeScore(blob_info, now));
+      }
+      blob_info.access_freq_ = 0;
+    }
+    // Place blobs by their rank among all blobs
+    for (auto &it : blob_map) {
+      BlobInfo &blob_info = it.second;
+      float rank = score_hist_.GetPercentile(blob_info.score_) / 100.0f;
+      if (ShouldReorganize(blob_info, rank)) {
+        MoveBlob(blob_info, rank);
+      }
+    }
+  }
+
+  /**
+   * Enforce the capacity watermarks of the local targets. A target above
+   * its max watermark first drops clean staged blobs, then demotes its
+   * lowest-scored blobs to the next slower tier. A target below its min
+   * watermark promotes the highest-scored blobs of slower tiers.
+   * */
+  void BalanceTargets(HermesLane &tls) {
+    BLOB_MAP_T &blob_map = tls.blob_map_;
+    for (TargetInfo &target : targets_) {
+      if (target.id_.node_id_ != CHI_CLIENT->node_id_) {
+        continue;
+      }
+      float usage = target.GetUtilization();
+      if (usage > target.borg_max_thresh_) {
+        size_t excess =
+            (usage - target.borg_max_thresh_) * target.stats_->max_cap_;
+        size_t freed = EvictCleanBlobs(tls, target, excess);
+        float prev_score = GetPrevTierScore(target.score_);
+        if (freed >= excess || prev_score < 0) {
+          continue;
+        }
+        DemoteBlobs(blob_map, target, prev_score, excess - freed);
+      } else if (usage < target.borg_min_thresh_) {
+        size_t deficit =
+            (target.borg_min_thresh_ - usage) * target.stats_->max_cap_;
+        PromoteBlobs(blob_map, target, deficit);
+      }
+    }
+  }
+
+  /** Record an access to a staged blob in the lane's eviction order */
+  void TouchStagedBlob(HermesLane &tls, BlobInfo &blob_info) {
+    chi::ScopedCoMutex clean_lock(tls.clean_blobs_lock_);
+    tls.clean_blobs_.Touch(blob_info.blob_id_);
+  }
+
+  /**
+   * Stage a blob in if it hasn't been. The first access to a cold blob
+   * reads it from the backend. Concurrent accesses wait for that read
+   * instead of issuing their own or reading the blob before it's filled.
+   * The blob must not be locked, since the stage-in writes it.
+   * */
+  void StageInBlob(HermesLane &tls, const TagId &tag_id, BlobInfo &blob_info,
+                   Task *task) {
+    std::shared_ptr<StageInFlight> flight;
+    {
+      chi::ScopedCoMutex stage_ins_lock(tls.stage_ins_lock_);
+      auto it = tls.stage_ins_.find(blob_info.blob_id_);
+      if (it != tls.stage_ins_.end()) {
+        flight = it->second;
+      } else if (blob_info.last_flush_ != (size_t)0) {
+        return;
+      } else {
+        blob_info.last_flush_ = 1;
+        tls.stage_ins_.emplace(blob_info.blob_id_,
+                               std::make_shared<StageInFlight>());
+      }
+    }
+    if (flight) {
+      while (!flight->done_.load()) {
+        task->Yield();
+      }
+      return;
+    }
+    // TODO(llogan): Don't hardcore score = 1
+    client_.StageIn(
+        HSHM_MCTX,
+        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
+        tag_id, blob_info.name_, 1);  // OK
+    chi::ScopedCoMutex stage_ins_lock(tls.stage_ins_lock_);
+    auto it = tls.stage_ins_.find(blob_info.blob_id_);
+    it->second->done_.store(true);
+    tls.stage_ins_.erase(it);
+  }
+
+  /** Whether a blob is being staged in */
+  static bool IsStagingIn(HermesLane &tls, const BlobId &blob_id) {
+    chi::ScopedCoMutex stage_ins_lock(tls.stage_ins_lock_);
+    return tls.stage_ins_.find(blob_id) != tls.stage_ins_.end();
+  }
+
+  /** Whether a blob can be dropped because the backend holds its data */
+  static bool IsEvictable(BlobInfo &blob_info) {
+    return !blob_info.buffers_.empty() &&
+           blob_info.flags_.Any(HERMES_DID_STAGE_IN) &&
+           blob_info.mod_count_ <= blob_info.last_flush_ &&
+           !blob_info.flags_.Any(HERMES_BLOB_IS_DIRTY |
+                                 HERMES_BLOB_IS_REORGANIZING);
+  }
+
+  /**
+   * Drop the buffers of clean staged blobs on \a target, coldest first,
+   * until \a size bytes are freed. Evicted blobs keep their metadata and
+   * are staged in again on their next access.
+   *
+   * @return the number of bytes freed on target
+   * */
+  size_t EvictCleanBlobs(HermesLane &tls, TargetInfo &target, size_t size) {
+    BLOB_MAP_T &blob_map = tls.blob_map_;
+    std::vector<BlobId> kept;
+    size_t freed = 0;
+    size_t count;
+    {
+      chi::ScopedCoMutex clean_lock(tls.clean_blobs_lock_);
+      count = tls.clean_blobs_.size();
+    }
+    for (; count > 0 && freed < size; --count) {
+      BlobId blob_id;
+      {
+        chi::ScopedCoMutex clean_lock(tls.clean_blobs_lock_);
+        if (!tls.clean_blobs_.PopVictim(blob_id)) {
+          break;
+        }
+      }
+      auto it = blob_map.find(blob_id);
+      if (it == blob_map.end()) {
+        continue;
+      }
+      BlobInfo &blob_info = it->second;
+      chi::ScopedCoRwWriteLock blob_info_lock(blob_info.lock_);
+      size_t target_size = 0;
+      for (BufferInfo &buf : blob_info.buffers_) {
+        if (buf.tid_ == target.id_) {
+          target_size += buf.size_;
+        }
+      }
+      if (target_size == 0 || !IsEvictable(blob_info) ||
+          IsStagingIn(tls, blob_id)) {
+        kept.emplace_back(blob_id);
+        continue;
+      }
+      HILOG(kDebug, "Evicting clean blob {} ({} bytes on target {})",
+            blob_id, target_size, target.id_);
+      FreeBuffers(blob_info.buffers_);
+      blob_info.max_blob_size_ = 0;
+      blob_info.mod_count_ = 0;
+      blob_info.last_flush_ = 0;
+      blob_info.flags_.UnsetBits(HERMES_DID_STAGE_IN);
+      freed += target_size;
+    }
+    // Blobs that were passed over keep their place at the cold end
+    chi::ScopedCoMutex clean_lock(tls.clean_blobs_lock_);
+    for (auto it = kept.rbegin(); it != kept.rend(); ++it) {
+      tls.clean_blobs_.PushCold(*it);
+    }
+    return freed;
+  }
+
+  /** Make room on the fastest local tier after puts spilled past it */
+  void ReclaimFastTier(HermesLane &tls, size_t size) {
+    TargetInfo *fastest = nullptr;
+    for (TargetInfo &target : targets_) {
+      if (target.id_.node_id_ != CHI_CLIENT->node_id_) {
+        continue;
+      }
+      if (!fastest || target.score_ > fastest->score_) {
+        fastest = &target;
+      }
+    }
+    if (fastest && fastest != fallback_target_) {
+      EvictCleanBlobs(tls, *fastest, size);
+    }
+  }
+
+  /** Move the coldest blobs on \a target to the tier of \a score */
+  void DemoteBlobs(BLOB_MAP_T &blob_map, TargetInfo &target, float score,
+                   size_t excess) {
+    std::vector<std::pair<size_t, BlobInfo *>> blobs;
+    for (auto &it : blob_map) {
+      BlobInfo &blob_info = it.second;
+      if (!IsMovable(blob_info)) {
+        continue;
+      }
+      size_t size = 0;
+      for (BufferInfo &buf : blob_info.buffers_) {
+        if (buf.tid_ == target.id_) {
+          size += buf.size_;
+        }
+      }
+      if (size > 0) {
+        blobs.emplace_back(size, &blob_info);
+      }
+    }
+    std::sort(blobs.begin(), blobs.end(), [](const auto &a, const auto &b) {
+      return a.second->score_ < b.second->score_;
+    });
+    size_t moved = 0;
+    for (auto &blob : blobs) {
+      if (moved >= excess) {
+        break;
+      }
+      MoveBlob(*blob.second, score);
+      moved += blob.first;
+    }
+  }
+
+  /** Move the hottest blobs of slower tiers into \a target */
+  void PromoteBlobs(BLOB_MAP_T &blob_map, TargetInfo &target,
+                    size_t deficit) {
+    std::vector<BlobInfo *> blobs;
+    for (auto &it : blob_map) {
+      BlobInfo &blob_info = it.second;
+      if (!IsMovable(blob_info) ||
+          blob_info.flags_.Any(HERMES_BLOB_IS_STREAMED)) {
+        continue;
+      }
+      auto tgt_it = target_map_.find(blob_info.buffers_[0].tid_);
+      if (tgt_it != target_map_.end() &&
+          tgt_it->second->score_ < target.score_) {
+        blobs.emplace_back(&blob_info);
+      }
+    }
+    std::sort(blobs.begin(), blobs.end(),
+              [](const BlobInfo *a, const BlobInfo *b) {
+                return a->score_ > b->score_;
+              });
+    size_t moved = 0;
+    for (BlobInfo *blob_info : blobs) {
+      if (moved >= deficit) {
+        break;
+      }
+      MoveBlob(*blob_info, target.score_);
+      moved += blob_info->blob_size_;
+    }
+  }
+
+  /**
+   * ========================================
+   * BUFFER Methods
+   * ========================================
+   * */
+
+  /**
+   * Allocate \a size bytes of buffers using the DPE of \a ctx. Targets
+   * on \a node_id are preferred. The new buffers are appended to
+   * \a buffers.
+   * */
+  void AllocateBuffers(size_t size, Context &ctx, chi::NodeId node_id,
+                       std::vector<BufferInfo> &buffers) {
+    std::vector<TargetInfo> targets = targets_;
+    std::vector<PlacementSchema> schema_vec;
+    auto *dpe = DpeFactory::Get(ctx);
+    // Prefer the node the blob is accessed from (this node by default)
+    if (node_id == 0) {
+      node_id = CHI_CLIENT->node_id_;
+    }
+    dpe->LocalityPlacement({size}, targets, node_id, ctx, schema_vec);
+
+    // Allocate blob buffers
+    for (PlacementSchema &schema : schema_vec) {
+      schema.plcmnts_.emplace_back(0, fallback_target_->id_);
+      for (size_t sub_idx = 0; sub_idx < schema.plcmnts_.size(); ++sub_idx) {
+        // Allocate chi::blocks
+        SubPlacement &placement = schema.plcmnts_[sub_idx];
+        TargetInfo &bdev = *target_map_[placement.tid_];
+        if (placement.size_ == 0) {
+          continue;
+        }
+        // Round to the slab classes of the target
+        size_t alloc_size = placement.size_;
+        if (bdev.slabs_) {
+          alloc_size = bdev.slabs_->RoundUp(placement.size_);
+        }
+        std::vector<chi::Block> blocks = bdev.client_.Allocate(
+            HSHM_MCTX,
+            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
+                                            bdev.id_.node_id_),
+            alloc_size);
+        // Convert to BufferInfo
+        size_t t_alloc = 0;
+        for (chi::Block &block : blocks) {
+          if (block.size_ == 0) {
+            continue;
+          }
+          buffers.emplace_back(placement.tid_, block);
+          if (bdev.slabs_) {
+            bdev.slabs_->Allocated(block.size_);
+          }
+          t_alloc += block.size_;
+        }
+        // HILOG(kInfo, "(node {}) Placing {}/{} bytes in target {} of bw {}",
+        //       CHI_CLIENT->node_id_, t_alloc, placement.size_, placement.tid_,
+        //       bdev.stats_->write_bw_);
+        // Spill to next tier
+        size_t next_tier = sub_idx + 1;
+        if (t_alloc < placement.size_ && next_tier < schema.plcmnts_.size()) {
+          SubPlacement &next_placement = schema.plcmnts_[next_tier];
+          size_t diff = placement.size_ - t_alloc;
+          next_placement.size_ += diff;
+        }
+        bdev.stats_->free_ -= t_alloc;
+        // The last placement is the fallback target
+        if (sub_idx + 1 == schema.plcmnts_.size()) {
+          spilled_bytes_ += t_alloc;
+        }
+      }
+    }
+  }
+
+  /** Record a foreground I/O on each target holding the buffers */
+  void CountForegroundIo(std::vector<BufferInfo> &buffers) {
+    TargetInfo *last = nullptr;
+    for (BufferInfo &buf : buffers) {
+      TargetInfo *target = target_map_[buf.tid_];
+      if (target != last) {
+        target->io_stats_->io_count_.fetch_add(1);
+        last = target;
+      }
+    }
+  }
+
+  /** Get the total capacity of a set of buffers */
+  static size_t GetBuffersSize(const std::vector<BufferInfo> &buffers) {
+    size_t size = 0;
+    for (const BufferInfo &buf : buffers) {
+      size += buf.size_;
+    }
+    return size;
+  }
+
+  /** Release a set of buffers back to their targets */
+  void FreeBuffers(std::vector<BufferInfo> &buffers) {
+    for (BufferInfo &buf : buffers) {
+      TargetInfo &target = *target_map_[buf.tid_];
+      target.client_.Free(HSHM_MCTX,
+                          chi::DomainQuery::GetDirectHash(
+                              chi::SubDomainId::kGlobalContainers,
+                              buf.tid_.node_id_),
+                          buf);
+      target.stats_->free_ += buf.size_;
+      if (target.slabs_) {
+        target.slabs_->Freed(buf.size_);
+      }
+      if (buf.codec_) {
+        target.io_stats_->raw_bytes_ -= buf.raw_size_;
+        target.io_stats_->stored_bytes_ -= buf.data_size_;
+      }
+    }
+    buffers.clear();
+  }
+
+  /** The codec all targets of \a buffers compress with, or kNone */
+  CompressCodec GetCodec(const std::vector<BufferInfo> &buffers) {
+    if (buffers.empty()) {
+      return CompressCodec::kNone;
+    }
+    u8 codec = target_map_[buffers[0].tid_]->codec_;
+    for (const BufferInfo &buf : buffers) {
+      if (target_map_[buf.tid_]->codec_ != codec) {
+        return CompressCodec::kNone;
+      }
+    }
+    return (CompressCodec)codec;
+  }
+
+  /** Whether a blob's buffers hold compressed data */
+  static bool IsCompressed(const std::vector<BufferInfo> &buffers) {
+    return !buffers.empty() && buffers[0].codec_ != 0;
+  }
+
+  /**
+   * Allocate buffers for a whole blob of \a size bytes and write \a data
+   * to them. If the blob lands on targets that compress, it is stored
+   * compressed when that saves enough space.
+   *
+   * @return false if there was not enough space. The buffers that were
+   * allocated are left in \a buffers and nothing is written.
+   * */
+  bool PlaceBlob(Task *task, hipc::Pointer data, size_t size, Context &ctx,
+                 chi::NodeId node_id, std::vector<BufferInfo> &buffers) {
+    AllocateBuffers(size, ctx, node_id, buffers);
+    if (GetBuffersSize(buffers) < size) {
+      return false;
+    }
+    CompressCodec codec = GetCodec(buffers);
+    if (codec == CompressCodec::kNone ||
+        !PlaceCompressed(task, data, size, codec, ctx, node_id, buffers)) {
+      WriteBuffers(task, buffers, data, 0, size);
+    }
+    return true;
+  }
+
+  /**
+   * Compress a blob and move it from the raw \a buffers allocated for it
+   * to buffers sized for the compressed data.
+   *
+   * @return false if the blob should be stored raw in \a buffers
+   * */
+  bool PlaceCompressed(Task *task, hipc::Pointer data, size_t size,
+                       CompressCodec codec, Context &ctx, chi::NodeId node_id,
+                       std::vector<BufferInfo> &buffers) {
+    char *raw = CHI_CLIENT->GetDataPointer(data);
+    if (!Compressor::IsCompressible(raw, size)) {
+      return false;
+    }
+    size_t bound = Compressor::GetBound(codec, size);
+    FullPtr<char> comp = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, bound);
+    size_t comp_size =
+        Compressor::Compress(codec, raw, size, comp.ptr_, bound);
+    if (comp_size == 0 ||
+        comp_size > size - (size_t)(size * Compressor::kMinSaving)) {
+      CHI_CLIENT->FreeBuffer(HSHM_MCTX, comp);
+      return false;
+    }
+    std::vector<BufferInfo> comp_buffers;
+    AllocateBuffers(comp_size, ctx, node_id, comp_buffers);
+    if (GetBuffersSize(comp_buffers) < comp_size ||
+        GetCodec(comp_buffers) != codec) {
+      FreeBuffers(comp_buffers);
+      CHI_CLIENT->FreeBuffer(HSHM_MCTX, comp);
+      return false;
+    }
+    WriteBuffers(task, comp_buffers, comp.shm_, 0, comp_size);
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, comp);
+    // Record the extent of the compressed data in each buffer
+    size_t comp_left = comp_size, raw_left = size;
+    for (BufferInfo &buf : comp_buffers) {
+      buf.codec_ = (u8)codec;
+      buf.data_size_ = std::min(buf.size_, comp_left);
+      if (buf.data_size_ == comp_left) {
+        buf.raw_size_ = raw_left;
+      } else {
+        buf.raw_size_ = size * buf.data_size_ / comp_size;
+      }
+      comp_left -= buf.data_size_;
+      raw_left -= buf.raw_size_;
+      TargetIoStats &io_stats = *target_map_[buf.tid_]->io_stats_;
+      io_stats.raw_bytes_ += buf.raw_size_;
+      io_stats.stored_bytes_ += buf.data_size_;
+    }
+    HILOG(kDebug, "Compressed a blob of {} bytes to {}", size, comp_size);
+    std::swap(buffers, comp_buffers);
+    FreeBuffers(comp_buffers);
+    return true;
+  }
+
+  /**
+   * Read the range [blob_off, blob_off + data_size) of a compressed blob.
+   * Only the prefix of the blob up to the end of the range is decoded.
+   * */
+  size_t ReadCompressed(Task *task, std::vector<BufferInfo> &buffers,
+                        hipc::Pointer data, size_t blob_off,
+                        size_t data_size) {
+    // The compressed data is read like a raw blob
+    std::vector<BufferInfo> extents;
+    size_t comp_size = 0, raw_size = 0;
+    for (BufferInfo buf : buffers) {
+      if (buf.data_size_ == 0) {
+        continue;
+      }
+      comp_size += buf.data_size_;
+      raw_size += buf.raw_size_;
+      buf.size_ = buf.data_size_;
+      buf.codec_ = 0;
+      extents.emplace_back(buf);
+    }
+    if (blob_off >= raw_size) {
+      return 0;
+    }
+    size_t raw_end = std::min(raw_size, blob_off + data_size);
+    FullPtr<char> comp = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, comp_size);
+    ReadBuffers(task, extents, comp.shm_, 0, comp_size);
+    FullPtr<char> raw = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, raw_end);
+    size_t decoded =
+        Compressor::Decompress((CompressCodec)buffers[0].codec_, comp.ptr_,
+                               comp_size, raw.ptr_, raw_end);
+    size_t read_size = 0;
+    if (decoded < raw_end) {
+      HELOG(kError, "Failed to decompress {} bytes of a blob", raw_end);
+    } else {
+      read_size = raw_end - blob_off;
+      memcpy(CHI_CLIENT->GetDataPointer(data), raw.ptr_ + blob_off,
+             read_size);
+    }
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, comp);
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, raw);
+    return read_size;
+  }
+
+  /**
+   * Store a compressed blob raw again so it can be modified in place.
+   * If there isn't room for the raw blob, the blob stays compressed.
+   *
+   * @return whether the blob was inflated
+   * */
+  bool InflateBlob(Task *task, BlobInfo &blob_info) {
+    size_t blob_size = blob_info.blob_size_;
+    Context ctx;
+    ctx.dpe_ = PlacementPolicy::kMinimizeIoTime;
+    ctx.blob_score_ = blob_info.score_;
+    std::vector<BufferInfo> buffers;
+    AllocateBuffers(blob_size, ctx, blob_info.buffers_[0].tid_.node_id_,
+                    buffers);
+    if (GetBuffersSize(buffers) < blob_size) {
+      HELOG(kError, "Could not find space to decompress blob {}",
+            blob_info.blob_id_);
+      FreeBuffers(buffers);
+      return false;
+    }
+    FullPtr<char> data = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, blob_size);
+    ReadBuffers(task, blob_info.buffers_, data.shm_, 0, blob_size);
+    WriteBuffers(task, buffers, data.shm_, 0, blob_size);
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, data);
+    std::swap(blob_info.buffers_, buffers);
+    blob_info.max_blob_size_ = GetBuffersSize(blob_info.buffers_);
+    FreeBuffers(buffers);
+    return true;
+  }
+
+  /** Write \a data to the blob range [blob_off, blob_off + data_size) */
+  void WriteBuffers(Task *task, std::vector<BufferInfo> &buffers,
+                    hipc::Pointer data, size_t blob_off, size_t data_size) {
+    std::vector<FullPtr<chi::bdev::WriteTask>> write_tasks;
+    std::vector<TargetInfo *> write_targets;
+    write_tasks.reserve(buffers.size());
+    write_targets.reserve(buffers.size());
+    size_t buf_off = 0;
+    size_t buf_left = 0, buf_right = 0;
+    size_t blob_right = blob_off + data_size;
+    bool found_left = false;
+    for (BufferInfo &buf : buffers) {
+      buf_right = buf_left + buf.size_;
+      if (blob_off >= blob_right) {
+        break;
+      }
+      if (buf_left <= blob_off && blob_off < buf_right) {
+        found_left = true;
+      }
+      if (found_left) {
+        size_t rel_off = blob_off - buf_left;
+        size_t tgt_off = buf.off_ + rel_off;
+        size_t buf_size = buf.size_ - rel_off;
+        if (buf_right > blob_right) {
+          buf_size = blob_right - (buf_left + rel_off);
+        }
+        HILOG(kDebug, "Writing {} bytes at off {} from target {}", buf_size,
+              tgt_off, buf.tid_);
+        TargetInfo &target = *target_map_[buf.tid_];
+        FullPtr<chi::bdev::WriteTask> write_task = target.client_.AsyncWrite(
+            HSHM_MCTX,
+            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
+                                            buf.tid_.node_id_),
+            data + buf_off, tgt_off, buf_size);
+        write_tasks.emplace_back(write_task);
+        write_targets.emplace_back(&target);
+        target.io_stats_->queue_depth_.fetch_add(1);
+        buf_off += buf_size;
+        blob_off = buf_right;
+      }
+      buf_left += buf.size_;
+    }
+
+    // Wait for the placements to complete
+    task->Wait(write_tasks);
+    for (FullPtr<chi::bdev::WriteTask> &write_task : write_tasks) {
+      CHI_CLIENT->DelTask(HSHM_MCTX, write_task);
+    }
+    for (TargetInfo *target : write_targets) {
+      target->io_stats_->queue_depth_.fetch_sub(1);
+    }
+  }
+
+  /**
+   * Read the blob range [blob_off, blob_off + data_size) into \a data.
+   * Returns the number of bytes read.
+   * */
+  size_t ReadBuffers(Task *task, std::vector<BufferInfo> &buffers,
+                     hipc::Pointer data, size_t blob_off, size_t data_size) {
+    if (IsCompressed(buffers)) {
+      return ReadCompressed(task, buffers, data, blob_off, data_size);
+    }
+    std::vector<FullPtr<chi::bdev::ReadTask>> read_tasks;
+    std::vector<TargetInfo *> read_targets;
+    read_tasks.reserve(buffers.size());
+    read_targets.reserve(buffers.size());
+    size_t buf_left = 0, buf_right = 0;
+    size_t buf_off = 0;
+    size_t blob_right = blob_off + data_size;
+    bool found_left = false;
+    for (BufferInfo &buf : buffers) {
+      buf_right = buf_left + buf.size_;
+      if (blob_off >= blob_right) {
+        break;
+      }
+      if (buf_left <= blob_off && blob_off < buf_right) {
+        found_left = true;
+      }
+      if (found_left) {
+        size_t rel_off = blob_off - buf_left;
+        size_t tgt_off = buf.off_ + rel_off;
+        size_t buf_size = buf.size_ - rel_off;
+        if (buf_right > blob_right) {
+          buf_size = blob_right - (buf_left + rel_off);
+        }
+        HILOG(kDebug, "Loading {} bytes at off {} from target {}", buf_size,
+              tgt_off, buf.tid_);
+        TargetInfo &target = *target_map_[buf.tid_];
+        FullPtr<chi::bdev::ReadTask> read_task = target.client_.AsyncRead(
+            HSHM_MCTX,
+            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
+                                            buf.tid_.node_id_),
+            data + buf_off, tgt_off, buf_size);
+        read_tasks.emplace_back(read_task);
+        read_targets.emplace_back(&target);
+        target.io_stats_->queue_depth_.fetch_add(1);
+        buf_off += buf_size;
+        blob_off = buf_right;
+      }
+      buf_left += buf.size_;
+    }
+    task->Wait(read_tasks);
+    for (FullPtr<chi::bdev::ReadTask> &read_task : read_tasks) {
+      CHI_CLIENT->DelTask(HSHM_MCTX, read_task);
+    }
+    for (TargetInfo *target : read_targets) {
+      target->io_stats_->queue_depth_.fetch_sub(1);
     }
-    // Flush blobs
+    return buf_off;
   }
-  void MonitorTagFlush(MonitorModeId mode, TagFlushTask *task,
-                       RunContext &rctx) {}
-  CHI_END(TagUpdateSize)
 
   /**
    * ========================================
@@ -684,6 +1606,7 @@ class Server : public Module {
       blob_info.mod_count_ = 0;
       blob_info.access_freq_ = 0;
       blob_info.last_flush_ = 0;
+      score_hist_.Increment(blob_info.score_, CHI_CUR_LANE->lane_id_);
       return blob_id;
     }
     return it->second;
@@ -863,17 +1786,45 @@ class Server : public Module {
       return;
     }
     BlobInfo &blob_info = it->second;
-    chi::ScopedCoRwWriteLock blob_info_lock(blob_info.lock_);
+
+    // Detect write-once streams
+    bool staged_put = task->flags_.Any(HERMES_DID_STAGE_IN);
+    bool should_stage_in = task->flags_.Any(HERMES_SHOULD_STAGE) &&
+                           !staged_put;
+    bool streamed;
+    if (staged_put) {
+      streamed = IsStreamFill(tls, task->tag_id_, blob_info);
+    } else {
+      streamed = RecordAccess(
+          tls, task->tag_id_, blob_info,
+          (should_stage_in && blob_info.last_flush_ == (size_t)0) ||
+              task->flags_.Any(HERMES_BLOB_DID_CREATE));
+    }
 
     // Stage Blob
-    if (task->flags_.Any(HERMES_SHOULD_STAGE) &&
-        blob_info.last_flush_ == (size_t)0) {
-      // TODO(llogan): Don't hardcore score = 1
-      blob_info.last_flush_ = 1;
-      client_.StageIn(HSHM_MCTX,
-                      chi::DomainQuery::GetDirectHash(
-                          chi::SubDomainId::kLocalContainers, 0),
-                      task->tag_id_, blob_info.name_, 1);  // OK
+    if (should_stage_in) {
+      StageInBlob(tls, task->tag_id_, blob_info, task);
+    }
+    chi::ScopedCoRwWriteLock blob_info_lock(blob_info.lock_);
+
+    // Staged-in data is clean and never replaces newer data
+    if (staged_put) {
+      if (blob_info.mod_count_ > 0) {
+        HILOG(kDebug, "Blob {} is already resident, skipping stage in",
+              blob_name.str());
+        return;
+      }
+      if (blob_info.last_flush_ == 0) {
+        blob_info.last_flush_ = 1;
+      }
+    }
+
+    // Compressed blobs are modified raw. Without room to inflate the blob,
+    // the put is dropped rather than truncating the blob.
+    if (IsCompressed(blob_info.buffers_) && !InflateBlob(task, blob_info)) {
+      HELOG(kError, "Dropping a put of {} bytes to compressed blob {}",
+            task->data_size_, blob_info.blob_id_);
+      return;
     }
 
     // Determine amount of additional buffering space needed
@@ -891,109 +1842,50 @@ class Server : public Module {
     HILOG(kDebug, "The size diff is {} bytes (bkt diff {})", size_diff,
           bkt_size_diff);
 
-    // Use DPE
-    std::vector<TargetInfo> targets = targets_;
-    std::vector<PlacementSchema> schema_vec;
+    // Allocate additional buffers
+    bool placed = false;
     if (size_diff > 0) {
       Context ctx;
-      auto *dpe = DpeFactory::Get(ctx.dpe_);
+      ctx.dpe_ = task->dpe_;
+      ctx.objective_ = task->objective_;
       ctx.blob_score_ = task->score_;
-      dpe->Placement({size_diff}, targets, ctx, schema_vec);
-    }
-
-    // Allocate blob buffers
-    for (PlacementSchema &schema : schema_vec) {
-      schema.plcmnts_.emplace_back(0, fallback_target_->id_);
-      for (size_t sub_idx = 0; sub_idx < schema.plcmnts_.size(); ++sub_idx) {
-        // Allocate chi::blocks
-        SubPlacement &placement = schema.plcmnts_[sub_idx];
-        TargetInfo &bdev = *target_map_[placement.tid_];
-        if (placement.size_ == 0) {
-          continue;
-        }
-        std::vector<chi::Block> blocks = bdev.client_.Allocate(
-            HSHM_MCTX,
-            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
-                                            bdev.id_.node_id_),
-            placement.size_);
-        // Convert to BufferInfo
-        size_t t_alloc = 0;
-        for (chi::Block &block : blocks) {
-          if (block.size_ == 0) {
-            continue;
-          }
-          blob_info.buffers_.emplace_back(placement.tid_, block);
-          t_alloc += block.size_;
-        }
-        // HILOG(kInfo, "(node {}) Placing {}/{} bytes in target {} of bw {}",
-        //       CHI_CLIENT->node_id_, t_alloc, placement.size_, placement.tid_,
-        //       bdev.stats_->write_bw_);
-        // Spill to next tier
-        size_t next_tier = sub_idx + 1;
-        if (t_alloc < placement.size_ && next_tier < schema.plcmnts_.size()) {
-          SubPlacement &next_placement = schema.plcmnts_[next_tier];
-          size_t diff = placement.size_ - t_alloc;
-          next_placement.size_ += diff;
-        }
-        bdev.stats_->free_ -= t_alloc;
+      // Streams go to the slowest tier until they show reuse
+      if (streamed) {
+        ctx.blob_score_ = 0;
+        blob_info.flags_.SetBits(HERMES_BLOB_IS_STREAMED);
+      }
+      if (blob_info.buffers_.empty() && task->blob_off_ == 0) {
+        // A new blob is placed whole, so its tier may compress it
+        placed = PlaceBlob(task, task->data_, task->data_size_, ctx,
+                           task->access_node_id_, blob_info.buffers_);
+      } else {
+        AllocateBuffers(size_diff, ctx, task->access_node_id_,
+                        blob_info.buffers_);
       }
+      // Slab rounding may leave slack past the end of the blob
+      blob_info.max_blob_size_ = IsCompressed(blob_info.buffers_)
+                                     ? 0
+                                     : GetBuffersSize(blob_info.buffers_);
     }
 
     // Place blob in buffers
-    std::vector<FullPtr<chi::bdev::WriteTask>> write_tasks;
-    write_tasks.reserve(blob_info.buffers_.size());
-    size_t blob_off = task->blob_off_, buf_off = 0;
-    size_t buf_left = 0, buf_right = 0;
-    size_t blob_right = task->blob_off_ + task->data_size_;
     HILOG(kDebug, "Number of buffers {}", blob_info.buffers_.size());
-    bool found_left = false;
-    for (BufferInfo &buf : blob_info.buffers_) {
-      buf_right = buf_left + buf.size_;
-      if (blob_off >= blob_right) {
-        break;
-      }
-      if (buf_left <= blob_off && blob_off < buf_right) {
-        found_left = true;
-      }
-      if (found_left) {
-        size_t rel_off = blob_off - buf_left;
-        size_t tgt_off = buf.off_ + rel_off;
-        size_t buf_size = buf.size_ - rel_off;
-        if (buf_right > blob_right) {
-          buf_size = blob_right - (buf_left + rel_off);
-        }
-        HILOG(kDebug, "Writing {} bytes at off {} from target {}", buf_size,
-              tgt_off, buf.tid_);
-        TargetInfo &target = *target_map_[buf.tid_];
-        FullPtr<chi::bdev::WriteTask> write_task = target.client_.AsyncWrite(
-            HSHM_MCTX,
-            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
-                                            0),
-            task->data_ + buf_off, tgt_off, buf_size);
-        write_tasks.emplace_back(write_task);
-        buf_off += buf_size;
-        blob_off = buf_right;
-      }
-      buf_left += buf.size_;
+    if (!placed) {
+      WriteBuffers(task, blob_info.buffers_, task->data_, task->blob_off_,
+                   task->data_size_);
     }
-    blob_info.max_blob_size_ = blob_off;
-
-    // Wait for the placements to complete
-    task->Wait(write_tasks);
-    for (FullPtr<chi::bdev::WriteTask> &write_task : write_tasks) {
-      CHI_CLIENT->DelTask(HSHM_MCTX, write_task);
+    CountForegroundIo(blob_info.buffers_);
+    if (task->flags_.Any(HERMES_DID_STAGE_IN)) {
+      blob_info.flags_.SetBits(HERMES_DID_STAGE_IN);
     }
 
     // Update information
     if (task->flags_.Any(HERMES_SHOULD_STAGE)) {
-      STAGER_MAP_T &stager_map = tls.stager_map_;
-      chi::ScopedCoMutex stager_map_lock(tls.stager_map_lock_);
-      auto it = stager_map.find(task->tag_id_);
-      if (it == stager_map.end()) {
+      std::shared_ptr<AbstractStager> stager;
+      if (!stager_map_.Get(task->tag_id_, stager)) {
         HELOG(kWarning, "Could not find stager for tag {}. Not updating size",
               task->tag_id_);
       } else {
-        std::shared_ptr<AbstractStager> &stager = it->second;
         stager->UpdateSize(HSHM_MCTX, client_, task->tag_id_,
                            blob_info.name_.str(), task->blob_off_,
                            task->data_size_);
@@ -1023,6 +1915,10 @@ class Server : public Module {
     // Free data
     HILOG(kDebug, "Completing PUT for {}", blob_name.str());
     blob_info.UpdateWriteStats();
+    MarkDirty(tls, blob_info, task->blob_off_, task->data_size_);
+    if (task->flags_.Any(HERMES_SHOULD_STAGE)) {
+      TouchStagedBlob(tls, blob_info);
+    }
     IoStat *stat;
     hshm::qtok_t qtok = io_pattern_.push(IoStat{
         IoType::kWrite, task->blob_id_, task->tag_id_, task->data_size_, 0});
@@ -1056,15 +1952,18 @@ class Server : public Module {
     BLOB_MAP_T &blob_map = tls.blob_map_;
     BlobInfo &blob_info = blob_map[task->blob_id_];
 
+    // Detect scan-once streams before staging in
+    bool should_stage_in = task->flags_.Any(HERMES_SHOULD_STAGE);
+    if (!task->flags_.Any(HERMES_BACKGROUND_IO)) {
+      RecordAccess(
+          tls, task->tag_id_, blob_info,
+          (should_stage_in && blob_info.last_flush_ == (size_t)0) ||
+              task->flags_.Any(HERMES_BLOB_DID_CREATE));
+    }
+
     // Stage Blob
-    if (task->flags_.Any(HERMES_SHOULD_STAGE) &&
-        blob_info.last_flush_ == (size_t)0) {
-      // TODO(llogan): Don't hardcore score = 1
-      blob_info.last_flush_ = 1;
-      client_.StageIn(HSHM_MCTX,
-                      chi::DomainQuery::GetDirectHash(
-                          chi::SubDomainId::kLocalContainers, 0),
-                      task->tag_id_, blob_info.name_, 1);  // OK
+    if (should_stage_in) {
+      StageInBlob(tls, task->tag_id_, blob_info, task);
     }
 
     // Get blob struct
@@ -1078,53 +1977,20 @@ class Server : public Module {
     }
 
     // Read blob from buffers
-    std::vector<FullPtr<chi::bdev::ReadTask>> read_tasks;
-    read_tasks.reserve(blob_info.buffers_.size());
     HILOG(kDebug,
           "Getting blob {} of size {} starting at offset {} "
           "(total_blob_size={}, buffers={})",
           task->blob_id_, task->data_size_, task->blob_off_,
           blob_info.blob_size_, blob_info.buffers_.size());
-    size_t blob_off = task->blob_off_;
-    size_t buf_left = 0, buf_right = 0;
-    size_t buf_off = 0;
-    size_t blob_right = task->blob_off_ + task->data_size_;
-    bool found_left = false;
-    for (BufferInfo &buf : blob_info.buffers_) {
-      buf_right = buf_left + buf.size_;
-      if (blob_off >= blob_right) {
-        break;
-      }
-      if (buf_left <= blob_off && blob_off < buf_right) {
-        found_left = true;
-      }
-      if (found_left) {
-        size_t rel_off = blob_off - buf_left;
-        size_t tgt_off = buf.off_ + rel_off;
-        size_t buf_size = buf.size_ - rel_off;
-        if (buf_right > blob_right) {
-          buf_size = blob_right - (buf_left + rel_off);
-        }
-        HILOG(kDebug, "Loading {} bytes at off {} from target {}", buf_size,
-              tgt_off, buf.tid_);
-        TargetInfo &target = *target_map_[buf.tid_];
-        FullPtr<chi::bdev::ReadTask> read_task = target.client_.AsyncRead(
-            HSHM_MCTX,
-            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kGlobalContainers,
-                                            0),
-            task->data_ + buf_off, tgt_off, buf_size);
-        read_tasks.emplace_back(read_task);
-        buf_off += buf_size;
-        blob_off = buf_right;
-      }
-      buf_left += buf.size_;
-    }
-    task->Wait(read_tasks);
-    for (FullPtr<chi::bdev::ReadTask> &read_task : read_tasks) {
-      CHI_CLIENT->DelTask(HSHM_MCTX, read_task);
+    task->data_size_ = ReadBuffers(task, blob_info.buffers_, task->data_,
+                                   task->blob_off_, task->data_size_);
+    if (!task->flags_.Any(HERMES_BACKGROUND_IO)) {
+      CountForegroundIo(blob_info.buffers_);
     }
-    task->data_size_ = buf_off;
     blob_info.UpdateReadStats();
+    if (task->flags_.Any(HERMES_SHOULD_STAGE)) {
+      TouchStagedBlob(tls, blob_info);
+    }
     IoStat *stat;
     hshm::qtok_t qtok = io_pattern_.push(IoStat{
         IoType::kRead, task->blob_id_, task->tag_id_, task->data_size_, 0});
@@ -1162,13 +2028,12 @@ class Server : public Module {
     }
     BlobInfo &blob = it->second;
     // Free blob buffers
-    for (BufferInfo &buf : blob.buffers_) {
-      TargetInfo &target = *target_map_[buf.tid_];
-      target.client_.Free(HSHM_MCTX,
-                          chi::DomainQuery::GetDirectHash(
-                              chi::SubDomainId::kGlobalContainers, 0),
-                          buf);
-      target.stats_->free_ += buf.size_;
+    FreeBuffers(blob.buffers_);
+    dirty_bytes_ -= blob.dirty_.GetSize();
+    score_hist_.Decrement(blob.score_, CHI_CUR_LANE->lane_id_);
+    {
+      chi::ScopedCoMutex clean_lock(tls.clean_blobs_lock_);
+      tls.clean_blobs_.Erase(task->blob_id_);
     }
     // Remove blob from the tag
     if (!task->flags_.Any(DestroyBlobTask::kKeepInTag)) {
@@ -1251,7 +2116,8 @@ class Server : public Module {
     // Get blob ID
     chi::string blob_name(task->blob_name_);
     if (task->blob_id_.IsNull()) {
-      auto blob_id_map_it = blob_id_map.find(blob_name);
+      auto blob_id_map_it =
+          blob_id_map.find(GetBlobNameWithBucket(task->tag_id_, blob_name));
       if (blob_id_map_it == blob_id_map.end()) {
         return;
       }
@@ -1263,30 +2129,48 @@ class Server : public Module {
       return;
     }
     BlobInfo &blob_info = blob_map_it->second;
-    // Check if it is worth updating the score
-    // TODO(llogan)
-    // Set the new score
+    chi::ScopedCoRwWriteLock blob_info_lock(blob_info.lock_);
+    blob_info.flags_.UnsetBits(HERMES_BLOB_IS_REORGANIZING);
+    // Set the new score. User scores stick until the user changes them.
     if (task->is_user_score_) {
       blob_info.user_score_ = task->score_;
-      blob_info.score_ = blob_info.user_score_;
-    } else {
-      blob_info.score_ = task->score_;
+      blob_info.flags_.SetBits(HERMES_USER_SCORE_STATIONARY);
+      SetBlobScore(blob_info, blob_info.user_score_);
     }
-    // Get the blob
-    FullPtr<char> data =
-        CHI_CLIENT->AllocateBuffer(HSHM_MCTX, blob_info.blob_size_);
-    client_.GetBlob(
-        HSHM_MCTX,
-        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
-        task->tag_id_, task->blob_id_, 0, blob_info.blob_size_, data.shm_,
-        0);  // OK
-    // Put the blob with the new score
-    client_.AsyncPutBlob(
-        HSHM_MCTX,
-        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
-        task->tag_id_, chi::string(""), task->blob_id_, 0, blob_info.blob_size_,
-        data.shm_, blob_info.score_, TASK_FIRE_AND_FORGET | TASK_DATA_OWNER,
-        0);  // OK
+    // Check if it is worth moving the blob
+    if (blob_info.buffers_.empty()) {
+      return;
+    }
+    auto target_it = target_map_.find(blob_info.buffers_[0].tid_);
+    if (target_it != target_map_.end() &&
+        target_it->second->score_ == GetTierScore(task->score_)) {
+      return;
+    }
+    // Read the blob from its current buffers
+    size_t blob_size = blob_info.blob_size_;
+    FullPtr<char> data = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, blob_size);
+    ReadBuffers(task, blob_info.buffers_, data.shm_, 0, blob_size);
+    // Place the blob with the new score, staying on the same node.
+    // MinimizeIoTime is the engine that places blobs by tier score.
+    Context ctx;
+    ctx.dpe_ = PlacementPolicy::kMinimizeIoTime;
+    ctx.blob_score_ = task->score_;
+    std::vector<BufferInfo> buffers;
+    if (!PlaceBlob(task, data.shm_, blob_size, ctx,
+                   blob_info.buffers_[0].tid_.node_id_, buffers)) {
+      HELOG(kWarning, "Could not find space to move blob {}",
+            blob_info.blob_id_);
+      FreeBuffers(buffers);
+      CHI_CLIENT->FreeBuffer(HSHM_MCTX, data);
+      return;
+    }
+    CHI_CLIENT->FreeBuffer(HSHM_MCTX, data);
+    // Release the old buffers
+    std::swap(blob_info.buffers_, buffers);
+    blob_info.max_blob_size_ = IsCompressed(blob_info.buffers_)
+                                   ? 0
+                                   : GetBuffersSize(blob_info.buffers_);
+    FreeBuffers(buffers);
   }
   void MonitorReorganizeBlob(MonitorModeId mode, ReorganizeBlobTask *task,
                              RunContext &rctx) {
@@ -1300,87 +2184,275 @@ class Server : public Module {
   CHI_END(ReorganizeBlob)
 
   CHI_BEGIN(FlushBlob)
-  /** FlushBlob */
-  void _FlushBlob(HermesLane &tls, BlobId blob_id, RunContext &rctx) {
-    BLOB_MAP_T &blob_map = tls.blob_map_;
-    // Can we find the blob
-    auto it = blob_map.find(blob_id);
-    if (it == blob_map.end()) {
+  /**
+   * Record that [off, off + size) of a staged blob was modified and queue
+   * the blob for flushing when it becomes dirty
+   * */
+  void MarkDirty(HermesLane &tls, BlobInfo &blob_info, size_t off,
+                 size_t size) {
+    if (blob_info.last_flush_ == 0 ||
+        blob_info.mod_count_ <= blob_info.last_flush_) {
       return;
     }
-    BlobInfo &blob_info = it->second;
-    FlushInfo flush_info;
-    flush_info.blob_info_ = &blob_info;
-    flush_info.mod_count_ = blob_info.mod_count_;
-    // Is the blob already flushed?
-    if (blob_info.last_flush_ <= 0 ||
-        flush_info.mod_count_ <= blob_info.last_flush_) {
+    size_t dirty_size = blob_info.dirty_.GetSize();
+    blob_info.dirty_.Add(off, size);
+    dirty_bytes_ += blob_info.dirty_.GetSize() - dirty_size;
+    QueueDirty(tls, blob_info);
+  }
+
+  /** Queue a blob for flushing unless it is already queued */
+  void QueueDirty(HermesLane &tls, BlobInfo &blob_info) {
+    if (blob_info.flags_.Any(HERMES_BLOB_IS_DIRTY)) {
       return;
     }
-    HILOG(kDebug, "Flushing blob {} (mod_count={}, last_flush={})",
-          blob_info.blob_id_, flush_info.mod_count_, blob_info.last_flush_);
-    // If the worker is being flushed
-    if (rctx.worker_props_.Any(CHI_WORKER_IS_FLUSHING)) {
-      ++rctx.flush_->count_;
+    chi::ScopedCoMutex dirty_lock(tls.dirty_blobs_lock_);
+    blob_info.flags_.SetBits(HERMES_BLOB_IS_DIRTY);
+    tls.dirty_blobs_.emplace_back(blob_info.blob_id_);
+  }
+
+  /**
+   * Flush a batch of blobs. The dirty ranges of the blobs are read in
+   * parallel and the ranges of each tag are handed to its stager together
+   * so writes can merge. Stagers that can't write ranges get whole blobs.
+   * Blobs whose write-back failed stay dirty and are queued again, and
+   * \a ok (if given) is cleared.
+   * */
+  size_t _FlushBlobs(HermesLane &tls, std::list<BlobId> &blob_ids,
+                     Task *task, RunContext &rctx, bool *ok = nullptr) {
+    size_t flushed = 0;
+    BLOB_MAP_T &blob_map = tls.blob_map_;
+    std::unordered_map<TagId, std::shared_ptr<AbstractStager>> stagers;
+    std::unordered_map<TagId, std::vector<FlushInfo>> batches;
+    std::vector<FullPtr<GetBlobTask>> get_tasks;
+    for (BlobId &blob_id : blob_ids) {
+      auto it = blob_map.find(blob_id);
+      if (it == blob_map.end()) {
+        continue;
+      }
+      BlobInfo &blob_info = it->second;
+      size_t mod_count = blob_info.mod_count_;
+      // Is the blob already flushed?
+      if (blob_info.last_flush_ <= 0 || mod_count <= blob_info.last_flush_) {
+        continue;
+      }
+      // Find the stager of the blob's tag
+      auto stager_it = stagers.find(blob_info.tag_id_);
+      if (stager_it == stagers.end()) {
+        std::shared_ptr<AbstractStager> stager;
+        if (!stager_map_.Get(blob_info.tag_id_, stager)) {
+          HELOG(kError, "Could not find stager for bucket: {}",
+                blob_info.tag_id_);
+          if (ok) {
+            *ok = false;
+          }
+          continue;
+        }
+        stager_it = stagers.emplace(blob_info.tag_id_, std::move(stager)).first;
+      }
+      // If the worker is being flushed
+      if (rctx.worker_props_.Any(CHI_WORKER_IS_FLUSHING)) {
+        ++rctx.flush_->count_;
+      }
+      // Read the ranges modified since the last flush
+      ByteRangeSet dirty;
+      dirty.swap(blob_info.dirty_);
+      dirty_bytes_ -= dirty.GetSize();
+      if (dirty.empty() || !stager_it->second->CanStageRanges()) {
+        dirty.clear();
+        dirty.Add(0, blob_info.blob_size_);
+      }
+      HILOG(kDebug, "Flushing {} of {} bytes of blob {}", dirty.GetSize(),
+            blob_info.blob_size_, blob_info.blob_id_);
+      for (auto &range : dirty.ranges_) {
+        FlushInfo flush_info;
+        flush_info.blob_info_ = &blob_info;
+        flush_info.mod_count_ = mod_count;
+        flush_info.blob_off_ = range.first;
+        flush_info.size_ = range.second - range.first;
+        size_t size = flush_info.size_;
+        flush_info.data_ = CHI_CLIENT->AllocateBuffer(HSHM_MCTX, size);
+        flush_info.get_task_ = client_.AsyncGetBlob(
+            HSHM_MCTX,
+            chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers,
+                                            0),
+            blob_info.tag_id_, chi::string(""), blob_info.blob_id_,
+            range.first, size, flush_info.data_.shm_,
+            HERMES_BACKGROUND_IO);  // OK
+        get_tasks.emplace_back(flush_info.get_task_);
+        batches[blob_info.tag_id_].emplace_back(flush_info);
+      }
     }
-    FullPtr<char> data =
-        CHI_CLIENT->AllocateBuffer(HSHM_MCTX, blob_info.blob_size_);
-    client_.GetBlob(
-        HSHM_MCTX,
-        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
-        blob_info.tag_id_, blob_info.blob_id_, 0, blob_info.blob_size_,
-        data.shm_, 0);  // OK
-    adapter::BlobPlacement plcmnt;
-    plcmnt.DecodeBlobName(blob_info.name_, 4096);
-    HILOG(kDebug, "Flushing blob {} with first entry {}", plcmnt.page_,
-          (int)data.ptr_[0]);
-    client_.StageOut(
-        HSHM_MCTX,
-        chi::DomainQuery::GetDirectHash(chi::SubDomainId::kLocalContainers, 0),
-        blob_info.tag_id_, blob_info.name_, data.shm_, blob_info.blob_size_,
-        TASK_DATA_OWNER);  // OK
-    HILOG(kDebug, "Finished flushing blob {} with first entry {}", plcmnt.page_,
-          (int)data.ptr_[0]);
-    blob_info.last_flush_ = flush_info.mod_count_;
+    task->Wait(get_tasks);
+    // Stage out each tag's ranges as one batch
+    for (auto &batch : batches) {
+      std::vector<StageOutEntry> entries;
+      entries.reserve(batch.second.size());
+      for (FlushInfo &flush_info : batch.second) {
+        entries.push_back(StageOutEntry{flush_info.blob_info_->name_.str(),
+                                        flush_info.data_.shm_,
+                                        flush_info.get_task_->data_size_,
+                                        flush_info.blob_off_});
+      }
+      stagers[batch.first]->StageOutBatch(HSHM_MCTX, client_, batch.first,
+                                          entries, task);
+      // A blob is clean only if all of its ranges were written
+      std::unordered_set<BlobInfo *> failed;
+      for (size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i].ok_) {
+          failed.emplace(batch.second[i].blob_info_);
+        }
+      }
+      for (FlushInfo &flush_info : batch.second) {
+        BlobInfo &blob_info = *flush_info.blob_info_;
+        if (failed.find(&blob_info) == failed.end()) {
+          flushed += flush_info.get_task_->data_size_;
+          blob_info.last_flush_ = flush_info.mod_count_;
+          // The backend now holds the blob's data
+          blob_info.flags_.SetBits(HERMES_DID_STAGE_IN);
+        } else {
+          // Restore the ranges swapped out of the blob's dirty set
+          size_t dirty_size = blob_info.dirty_.GetSize();
+          blob_info.dirty_.Add(flush_info.blob_off_, flush_info.size_);
+          dirty_bytes_ += blob_info.dirty_.GetSize() - dirty_size;
+        }
+        CHI_CLIENT->DelTask(HSHM_MCTX, flush_info.get_task_);
+        CHI_CLIENT->FreeBuffer(HSHM_MCTX, flush_info.data_);
+      }
+      for (BlobInfo *blob_info : failed) {
+        HELOG(kWarning, "Failed to flush blob {}, retrying later",
+              blob_info->blob_id_);
+        QueueDirty(tls, *blob_info);
+      }
+      if (ok && !failed.empty()) {
+        *ok = false;
+      }
+    }
+    return flushed;
   }
+  /** FlushBlob */
   void FlushBlob(FlushBlobTask *task, RunContext &rctx) {
     HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
     chi::ScopedCoRwReadLock blob_map_lock(tls.blob_map_lock_);
-    _FlushBlob(tls, task->blob_id_, rctx);
+    std::list<BlobId> blob_ids = {task->blob_id_};
+    _FlushBlobs(tls, blob_ids, task, rctx, &task->ok_);
   }
   void MonitorFlushBlob(MonitorModeId mode, FlushBlobTask *task,
                         RunContext &rctx) {}
   CHI_END(FlushBlob)
 
   CHI_BEGIN(FlushData)
+  /** Get the buffering capacity of the local targets */
+  size_t GetLocalCapacity() {
+    size_t capacity = 0;
+    for (TargetInfo &target : targets_) {
+      if (target.id_.node_id_ == CHI_CLIENT->node_id_) {
+        capacity += target.stats_->max_cap_;
+      }
+    }
+    return capacity;
+  }
+
+  /** Whether no local target has served foreground I/O recently */
+  bool TargetsIdle(hshm::Timepoint &now) {
+    BorgInfo &borg = HERMES_SERVER_CONF.borg_;
+    bool idle = true;
+    for (TargetInfo &target : targets_) {
+      if (target.id_.node_id_ != CHI_CLIENT->node_id_) {
+        continue;
+      }
+      TargetIoStats &io = *target.io_stats_;
+      size_t io_count = io.io_count_.load();
+      if (io_count != io.last_io_count_) {
+        io.last_io_count_ = io_count;
+        io.idle_since_ = now;
+      }
+      if (io.idle_since_.GetMsecFromStart(now) < borg.flush_idle_time_) {
+        idle = false;
+      }
+    }
+    return idle;
+  }
+
+  /**
+   * Decide how many bytes this sweep may flush. Flushing is paced by a
+   * token bucket refilled at flush_bandwidth and waits for idle targets
+   * while little data is dirty. Once dirty data nears the buffering
+   * capacity, both limits are ignored.
+   * */
+  size_t GetFlushBudget(hshm::Timepoint &now) {
+    BorgInfo &borg = HERMES_SERVER_CONF.borg_;
+    constexpr size_t kUnlimited = std::numeric_limits<size_t>::max();
+    // Refill the bucket with up to one second of bandwidth
+    double elapsed = last_sweep_.GetSecFromStart(now);
+    last_sweep_ = now;
+    if (borg.flush_bandwidth_ > 0) {
+      flush_tokens_ = std::min(flush_tokens_ + elapsed * borg.flush_bandwidth_,
+                               (double)borg.flush_bandwidth_);
+    }
+    bool idle = TargetsIdle(now);
+    size_t dirty = dirty_bytes_.load();
+    size_t capacity = GetLocalCapacity();
+    float pressure = capacity ? (float)dirty / capacity : 1;
+    if (pressure >= borg.flush_dirty_high_) {
+      return kUnlimited;
+    }
+    if (pressure < borg.flush_dirty_low_ && !idle) {
+      return 0;
+    }
+    if (borg.flush_bandwidth_ == 0) {
+      return kUnlimited;
+    }
+    return flush_tokens_ > 0 ? (size_t)flush_tokens_ : 0;
+  }
+
   /** Flush blobs back to storage */
   void FlushData(FlushDataTask *task, RunContext &rctx) {
     HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
     chi::ScopedCoRwReadLock blob_map_lock(tls.blob_map_lock_);
-    BLOB_ID_MAP_T &blob_id_map = tls.blob_id_map_;
     BLOB_MAP_T &blob_map = tls.blob_map_;
-    for (auto &it : blob_map) {
-      BlobInfo &blob_info = it.second;
-      // Update blob scores
-      //      float new_score = MakeScore(blob_info, now);
-      //      blob_info.score_ = new_score;
-      //      if (ShouldReorganize<true>(blob_info, new_score,
-      //      task->task_node_)) {
-      //        Context ctx;
-      //        FullPtr<ReorganizeBlobTask> reorg_task =
-      //            blob_mdm_.AsyncReorganizeBlob(task->task_node_ + 1,
-      //                                          blob_info.tag_id_,
-      //                                          chi::string(""),
-      //                                          blob_info.blob_id_,
-      //                                          new_score, false, ctx,
-      //                                          TASK_LOW_LATENCY);
-      //        reorg_task->Wait<TASK_YIELD_CO>(task);
-      //        CHI_CLIENT->DelTask(HSHM_MCTX, reorg_task);
-      //      }
-      //      blob_info.access_freq_ = 0;
-
-      // Flush data
-      _FlushBlob(tls, blob_info.blob_id_, rctx);
+    // Update blob scores
+    hshm::Timepoint now;
+    now.Now();
+    if (last_reorg_.GetMsecFromStart(now) >=
+        HERMES_SERVER_CONF.borg_.blob_reorg_period_) {
+      last_reorg_ = now;
+      ReorganizeBlobs(blob_map, now);
+      BalanceTargets(tls);
+    }
+    // Puts spilled to the fallback target, so drop clean blobs right away
+    size_t spilled = spilled_bytes_.exchange(0);
+    if (spilled > 0) {
+      ReclaimFastTier(tls, spilled);
+    }
+    // Flush the blobs that were modified since their last flush
+    size_t byte_budget = GetFlushBudget(now);
+    if (rctx.worker_props_.Any(CHI_WORKER_IS_FLUSHING)) {
+      byte_budget = std::numeric_limits<size_t>::max();
+    }
+    if (byte_budget == 0) {
+      return;
+    }
+    size_t blob_budget = HERMES_SERVER_CONF.borg_.flush_budget_;
+    std::list<BlobId> dirty_blobs;
+    {
+      chi::ScopedCoMutex dirty_lock(tls.dirty_blobs_lock_);
+      size_t bytes = 0;
+      while (!tls.dirty_blobs_.empty() && bytes < byte_budget &&
+             (blob_budget == 0 || dirty_blobs.size() < blob_budget)) {
+        auto it = blob_map.find(tls.dirty_blobs_.front());
+        if (it != blob_map.end()) {
+          BlobInfo &blob_info = it->second;
+          blob_info.flags_.UnsetBits(HERMES_BLOB_IS_DIRTY);
+          bytes += blob_info.dirty_.empty() ? blob_info.blob_size_
+                                            : blob_info.dirty_.GetSize();
+        }
+        dirty_blobs.splice(dirty_blobs.end(), tls.dirty_blobs_,
+                           tls.dirty_blobs_.begin());
+      }
+    }
+    size_t flushed = _FlushBlobs(tls, dirty_blobs, task, rctx);
+    if (HERMES_SERVER_CONF.borg_.flush_bandwidth_ > 0) {
+      flush_tokens_ -= flushed;
     }
   }
   void MonitorFlushData(MonitorModeId mode, FlushDataTask *task,
@@ -1457,6 +2529,25 @@ class Server : public Module {
       stats.bandwidth_ = bdev_client.stats_->write_bw_;
       stats.latency_ = bdev_client.stats_->write_latency_;
       stats.score_ = bdev_client.score_;
+      stats.est_fragmentation_ = 0;
+      if (bdev_client.slabs_) {
+        SlabStats &slabs = *bdev_client.slabs_;
+        stats.slab_sizes_ = slabs.slab_sizes_;
+        stats.used_extents_.reserve(slabs.slab_sizes_.size());
+        stats.est_free_extents_.reserve(slabs.slab_sizes_.size());
+        for (size_t i = 0; i < slabs.slab_sizes_.size(); ++i) {
+          stats.used_extents_.emplace_back(slabs.used_[i].load());
+          stats.est_free_extents_.emplace_back(slabs.est_free_[i].load());
+        }
+        stats.est_fragmentation_ = slabs.EstimateFragmentation();
+      }
+      // Compression stretches the capacity by the bytes it saves
+      TargetIoStats &io_stats = *bdev_client.io_stats_;
+      stats.codec_ = bdev_client.codec_;
+      stats.raw_bytes_ = io_stats.raw_bytes_.load();
+      stats.stored_bytes_ = io_stats.stored_bytes_.load();
+      stats.effective_cap_ = stats.max_cap_ + (ssize_t)stats.raw_bytes_ -
+                             (ssize_t)stats.stored_bytes_;
       target_mdms.emplace_back(stats);
     }
     task->SetStats(target_mdms);
@@ -1529,9 +2620,6 @@ class Server : public Module {
   CHI_BEGIN(RegisterStager)
   /** The RegisterStager method */
   void RegisterStager(RegisterStagerTask *task, RunContext &rctx) {
-    HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
-    chi::ScopedCoMutex stager_map_lock(tls.stager_map_lock_);
-    STAGER_MAP_T &stager_map = tls.stager_map_;
     std::string tag_name = task->tag_name_.str();
     std::string params = task->params_.str();
     HILOG(kDebug, "Registering stager {}: {}", task->bkt_id_, tag_name);
@@ -1539,7 +2627,7 @@ class Server : public Module {
         StagerFactory::Get(tag_name, params);
     stager->RegisterStager(HSHM_MCTX, task->tag_name_.str(),
                            task->params_.str());
-    stager_map.emplace(task->bkt_id_, std::move(stager));
+    stager_map_.Emplace(task->bkt_id_, stager);
     HILOG(kDebug, "Finished registering stager {}: {}", task->bkt_id_,
           tag_name);
   }
@@ -1557,13 +2645,8 @@ class Server : public Module {
   /** The UnregisterStager method */
   void UnregisterStager(UnregisterStagerTask *task, RunContext &rctx) {
     HILOG(kDebug, "Unregistering stager {}", task->bkt_id_);
-    HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
-    chi::ScopedCoMutex stager_map_lock(tls.stager_map_lock_);
-    STAGER_MAP_T &stager_map = tls.stager_map_;
-    if (stager_map.find(task->bkt_id_) == stager_map.end()) {
-      return;
-    }
-    stager_map.erase(task->bkt_id_);
+    // The stager closes its files once in-flight stages release it
+    stager_map_.Erase(task->bkt_id_);
   }
   void MonitorUnregisterStager(MonitorModeId mode, UnregisterStagerTask *task,
                                RunContext &rctx) {
@@ -1578,19 +2661,17 @@ class Server : public Module {
   CHI_BEGIN(StageIn)
   /** The StageIn method */
   void StageIn(StageInTask *task, RunContext &rctx) {
-    HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
-    chi::ScopedCoMutex stager_map_lock(tls.stager_map_lock_);
-    STAGER_MAP_T &stager_map = tls.stager_map_;
-    STAGER_MAP_T::iterator it = stager_map.find(task->bkt_id_);
-    if (it == stager_map.end()) {
-      // HELOG(kError, "Could not find stager for bucket: {}", task->bkt_id_);
+    // Hold a reference so the stager outlives an unregister during I/O
+    std::shared_ptr<AbstractStager> stager;
+    if (!stager_map_.Get(task->bkt_id_, stager)) {
+      // HELOG(kError, "Could not find stager for bucket: {}",
+      //       task->bkt_id_);
       // TODO(llogan): Probably should add back...
       // task->SetModuleComplete();
       return;
     }
-    std::shared_ptr<AbstractStager> &stager = it->second;
     stager->StageIn(HSHM_MCTX, client_, task->bkt_id_, task->blob_name_.str(),
-                    task->score_);
+                    task->score_, task);
   }
   void MonitorStageIn(MonitorModeId mode, StageInTask *task, RunContext &rctx) {
     switch (mode) {
@@ -1604,17 +2685,14 @@ class Server : public Module {
   CHI_BEGIN(StageOut)
   /** The StageOut method */
   void StageOut(StageOutTask *task, RunContext &rctx) {
-    HermesLane &tls = tls_[CHI_CUR_LANE->lane_id_];
-    chi::ScopedCoMutex stager_map_lock(tls.stager_map_lock_);
-    STAGER_MAP_T &stager_map = tls.stager_map_;
-    STAGER_MAP_T::iterator it = stager_map.find(task->bkt_id_);
-    if (it == stager_map.end()) {
+    // Hold a reference so the stager outlives an unregister during I/O
+    std::shared_ptr<AbstractStager> stager;
+    if (!stager_map_.Get(task->bkt_id_, stager)) {
       HELOG(kError, "Could not find stager for bucket: {}", task->bkt_id_);
       return;
     }
-    std::shared_ptr<AbstractStager> &stager = it->second;
     stager->StageOut(HSHM_MCTX, client_, task->bkt_id_, task->blob_name_.str(),
-                     task->data_, task->data_size_);
+                     task->data_, task->data_size_, task);
   }
   void MonitorStageOut(MonitorModeId mode, StageOutTask *task,
                        RunContext &rctx) {
@@ -1626,6 +2704,72 @@ class Server : public Module {
   }
   CHI_END(StageOut)
 
+  CHI_BEGIN(Prestage)
+  /**
+   * Stage a range of a tag's backend in ahead of use. The range is read
+   * in batches of large parallel reads. total_ is the number of blobs in
+   * the range and staged_ counts the blobs put into hermes so far, so
+   * callers can poll the progress.
+   * */
+  void Prestage(PrestageTask *task, RunContext &rctx) {
+    // Hold a reference so the stager outlives an unregister during I/O
+    std::shared_ptr<AbstractStager> stager;
+    if (!stager_map_.Get(task->bkt_id_, stager)) {
+      HELOG(kError, "Could not find stager for bucket: {}", task->bkt_id_);
+      return;
+    }
+    // A size of 0 stages in up to the end of the backend
+    size_t size = task->size_;
+    if (size == 0) {
+      size_t backend_size = stager->GetBackendSize();
+      size = backend_size > task->off_ ? backend_size - task->off_ : 0;
+    }
+    std::vector<std::string> blob_names;
+    stager->GetBlobRange(task->off_, size, blob_names);
+    task->total_ = blob_names.size();
+    HILOG(kDebug, "Prestaging {} blobs of bucket {}", task->total_,
+          task->bkt_id_);
+    for (size_t i = 0; i < blob_names.size(); i += kPrestageBatch) {
+      size_t end = std::min(i + kPrestageBatch, blob_names.size());
+      std::vector<std::string> batch(blob_names.begin() + i,
+                                     blob_names.begin() + end);
+      task->staged_ += stager->StageInBatch(HSHM_MCTX, client_, task->bkt_id_,
+                                            batch, task->score_, task);
+    }
+  }
+  void MonitorPrestage(MonitorModeId mode, PrestageTask *task,
+                       RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+      }
+    }
+  }
+  CHI_END(Prestage)
+
+  CHI_BEGIN(SyncStager)
+  /** Make the data this node staged out to a tag's backend durable */
+  void SyncStager(SyncStagerTask *task, RunContext &rctx) {
+    std::shared_ptr<AbstractStager> stager;
+    if (!stager_map_.Get(task->bkt_id_, stager)) {
+      return;
+    }
+    task->ok_ = stager->Sync(task);
+  }
+  void MonitorSyncStager(MonitorModeId mode, SyncStagerTask *task,
+                         RunContext &rctx) {
+    switch (mode) {
+      case MonitorMode::kReplicaAgg: {
+        std::vector<FullPtr<Task>> &replicas = *rctx.replicas_;
+        for (FullPtr<Task> &replica : replicas) {
+          SyncStagerTask *replica_task = replica.Cast<SyncStagerTask>().ptr_;
+          task->ok_ &= replica_task->ok_;
+        }
+      }
+    }
+  }
+  CHI_END(SyncStager)
+
   CHI_AUTOGEN_METHODS
  public:
 #include "hermes_core/hermes_core_lib_exec.h"
@@ -67,8 +67,13 @@ class HermesUnitTests(Application):
             nprocs = len(self.jarvis.hostfile)
         test_ipc_execs = ['TestIpc', 'TestAsyncIpc', 'TestIO', 'TestIpcMultithread4', 'TestIpcMultithread8']
         test_config_execs = [
-            'TestHermesPaths'
+            'TestHermesPaths', 'TestSlabRounding'
         ]
+        test_data_stager_execs = ['TestLocalObjectTransport',
+                                  'TestStageOutBatch']
+        test_data_structures_execs = ['TestByteRangeSet', 'TestCompressor',
+                                      'TestRcuMap', 'TestScoreHistogram',
+                                      'TestSegmentedLru', 'TestStreamDetector']
         test_hermes_execs = [
             'TestHermesConnect', 'TestHermesPut1n', 'TestHermesPut', 'TestHermesSerializedPutGet',
             'TestHermesAsyncPut', 'TestHermesAsyncPutLocalFlush', 'TestHermesPutGet',
@@ -94,6 +99,16 @@ class HermesUnitTests(Application):
                              env=self.env,
                              do_dbg=self.config['do_dbg'],
                              dbg_port=self.config['dbg_port']))
+        elif self.config['TEST_CASE'] in test_data_structures_execs:
+            Exec(f'test_data_structures_exec {self.config["TEST_CASE"]}',
+                 LocalExecInfo(env=self.env,
+                             do_dbg=self.config['do_dbg'],
+                             dbg_port=self.config['dbg_port']))
+        elif self.config['TEST_CASE'] in test_data_stager_execs:
+            Exec(f'test_data_stager_exec {self.config["TEST_CASE"]}',
+                 LocalExecInfo(env=self.env,
+                             do_dbg=self.config['do_dbg'],
+                             dbg_port=self.config['dbg_port']))
         elif self.config['TEST_CASE'] in test_ipc_execs:
             Exec(f'test_ipc_exec {self.config["TEST_CASE"]}',
                  MpiExecInfo(hostfile=self.jarvis.hostfile,
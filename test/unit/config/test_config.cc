@@ -39,3 +39,37 @@ TEST_CASE("TestHermesPaths") {
     REQUIRE(info.Match("/home/hello/.json") == true);
   }
 }
+
+TEST_CASE("TestSlabRounding") {
+  hermes::SlabStats slabs;
+  slabs.Init({KILOBYTES(4), KILOBYTES(16), KILOBYTES(64), MEGABYTES(1)});
+
+  PAGE_DIVIDE("Exact slab sizes") {
+    REQUIRE(slabs.RoundUp(0) == 0);
+    REQUIRE(slabs.RoundUp(KILOBYTES(4)) == KILOBYTES(4));
+    REQUIRE(slabs.RoundUp(MEGABYTES(2)) == MEGABYTES(2));
+  }
+
+  PAGE_DIVIDE("Small tails are coalesced") {
+    REQUIRE(slabs.RoundUp(1) == KILOBYTES(4));
+    REQUIRE(slabs.RoundUp(KILOBYTES(40)) == KILOBYTES(64));
+    REQUIRE(slabs.RoundUp(MEGABYTES(1) + 100) ==
+            MEGABYTES(1) + KILOBYTES(4));
+  }
+
+  PAGE_DIVIDE("Large tails are split") {
+    REQUIRE(slabs.RoundUp(KILOBYTES(17)) == KILOBYTES(20));
+  }
+
+  PAGE_DIVIDE("Estimated fragmentation") {
+    REQUIRE(slabs.EstimateFragmentation() == 0);
+    slabs.Allocated(KILOBYTES(4));
+    slabs.Allocated(MEGABYTES(1));
+    slabs.Freed(KILOBYTES(4));
+    REQUIRE(slabs.EstimateFragmentation() == 1);
+    slabs.Freed(MEGABYTES(1));
+    REQUIRE(slabs.EstimateFragmentation() < 1);
+    slabs.Allocated(KILOBYTES(4));
+    REQUIRE(slabs.EstimateFragmentation() == 0);
+  }
+}
@@ -0,0 +1,69 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <set>
+
+#include "basic_test.h"
+#include "hermes/data_stager/abstract_stager.h"
+
+/** A stager whose writes to the blobs in failing_ fail */
+class FailingStager : public hermes::AbstractStager {
+ public:
+  std::set<std::string> failing_;
+  std::vector<std::string> staged_out_;
+
+  void RegisterStager(const hipc::MemContext &mctx,
+                      const std::string &tag_name,
+                      const std::string &params) override {}
+  bool StageIn(const hipc::MemContext &mctx, hermes::Client &client,
+               const hermes::TagId &tag_id, const std::string &blob_name,
+               float score, hermes::Task *task) override {
+    return false;
+  }
+  bool StageOut(const hipc::MemContext &mctx, hermes::Client &client,
+                const hermes::TagId &tag_id, const std::string &blob_name,
+                hipc::Pointer &data_p, size_t data_size,
+                hermes::Task *task) override {
+    staged_out_.emplace_back(blob_name);
+    return failing_.find(blob_name) == failing_.end();
+  }
+  void UpdateSize(const hipc::MemContext &mctx, hermes::Client &client,
+                  const hermes::TagId &tag_id, const std::string &blob_name,
+                  size_t blob_off, size_t data_size) override {}
+};
+
+TEST_CASE("TestStageOutBatch") {
+  FailingStager stager;
+  hermes::Client client;
+  hermes::TagId tag_id;
+  std::vector<hermes::StageOutEntry> entries(3);
+  for (size_t i = 0; i < entries.size(); ++i) {
+    entries[i].blob_name_ = "blob" + std::to_string(i);
+    entries[i].data_size_ = 4096;
+  }
+
+  PAGE_DIVIDE("Writes that succeed stay ok") {
+    stager.StageOutBatch(HSHM_MCTX, client, tag_id, entries, nullptr);
+    REQUIRE(stager.staged_out_.size() == 3);
+    for (hermes::StageOutEntry &entry : entries) {
+      REQUIRE(entry.ok_);
+    }
+  }
+
+  PAGE_DIVIDE("A failed write clears only its entry") {
+    stager.failing_.emplace("blob1");
+    stager.StageOutBatch(HSHM_MCTX, client, tag_id, entries, nullptr);
+    REQUIRE(entries[0].ok_);
+    REQUIRE(!entries[1].ok_);
+    REQUIRE(entries[2].ok_);
+  }
+}
@@ -0,0 +1,103 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <filesystem>
+
+#include "basic_test.h"
+#include "hermes/data_stager/object_transport.h"
+
+TEST_CASE("TestLocalObjectTransport") {
+  std::string root = "/tmp/test_hermes/objects";
+  std::filesystem::remove_all(root);
+  auto transport = hermes::ObjectTransport::Create("file://" + root);
+  REQUIRE(transport != nullptr);
+  REQUIRE(hermes::ObjectTransport::Create("s4://bucket") == nullptr);
+  REQUIRE(transport->GetMinPartSize() == 0);
+  std::string part1(4096, 'a'), part2(4096, 'b');
+  // The number of uploads that still have a directory
+  auto count_uploads = [&root]() {
+    size_t count = 0;
+    for (auto &entry :
+         std::filesystem::directory_iterator(root + "/.uploads")) {
+      count += entry.is_directory();
+    }
+    return count;
+  };
+
+  PAGE_DIVIDE("Parts apply at their offsets") {
+    std::string upload_id = transport->CreateUpload("bkt/obj");
+    REQUIRE(!upload_id.empty());
+    struct iovec iov2 = {&part2[0], part2.size()};
+    struct iovec iov1 = {&part1[0], part1.size()};
+    REQUIRE(transport->UploadPart("bkt/obj", upload_id, 2, 8192, &iov2, 1));
+    REQUIRE(transport->UploadPart("bkt/obj", upload_id, 1, 0, &iov1, 1));
+    REQUIRE(transport->GetSize("bkt/obj") == 0);
+    REQUIRE(transport->CompleteUpload("bkt/obj", upload_id));
+    REQUIRE(transport->GetSize("bkt/obj") == 12288);
+  }
+
+  PAGE_DIVIDE("Ranged GETs") {
+    std::string buf(8192, 0);
+    struct iovec iov[2] = {{&buf[0], 4096}, {&buf[4096], 4096}};
+    REQUIRE(transport->GetRange("bkt/obj", 4096, iov, 2) == 8192);
+    REQUIRE(buf.substr(0, 4096) == std::string(4096, 0));
+    REQUIRE(buf.substr(4096) == part2);
+    REQUIRE(transport->GetRange("bkt/obj", 12288, iov, 2) == 0);
+  }
+
+  PAGE_DIVIDE("Aborted uploads change nothing") {
+    std::string upload_id = transport->CreateUpload("bkt/obj");
+    struct iovec iov = {&part2[0], part2.size()};
+    REQUIRE(transport->UploadPart("bkt/obj", upload_id, 1, 0, &iov, 1));
+    transport->AbortUpload("bkt/obj", upload_id);
+    std::string buf(4096, 0);
+    struct iovec out = {&buf[0], buf.size()};
+    REQUIRE(transport->GetRange("bkt/obj", 0, &out, 1) == 4096);
+    REQUIRE(buf == part1);
+  }
+
+  PAGE_DIVIDE("Failed completions change nothing") {
+    REQUIRE(!transport->CompleteUpload("bkt/obj", "missing"));
+    REQUIRE(transport->GetSize("bkt/obj") == 12288);
+    std::string buf(4096, 0);
+    struct iovec out = {&buf[0], buf.size()};
+    REQUIRE(transport->GetRange("bkt/obj", 0, &out, 1) == 4096);
+    REQUIRE(buf == part1);
+    REQUIRE(count_uploads() == 0);
+  }
+
+  PAGE_DIVIDE("Transports sharing a root keep their uploads apart") {
+    auto other = hermes::ObjectTransport::Create("file://" + root);
+    std::string id1 = transport->CreateUpload("bkt/obj1");
+    std::string id2 = other->CreateUpload("bkt/obj2");
+    REQUIRE(!id1.empty());
+    REQUIRE(!id2.empty());
+    REQUIRE(id1 != id2);
+    struct iovec iov1 = {&part1[0], part1.size()};
+    struct iovec iov2 = {&part2[0], part2.size()};
+    REQUIRE(transport->UploadPart("bkt/obj1", id1, 1, 0, &iov1, 1));
+    REQUIRE(other->UploadPart("bkt/obj2", id2, 1, 4096, &iov2, 1));
+    REQUIRE(transport->UploadPart("bkt/obj1", id1, 2, 4096, &iov1, 1));
+    REQUIRE(other->CompleteUpload("bkt/obj2", id2));
+    REQUIRE(count_uploads() == 1);
+    REQUIRE(transport->CompleteUpload("bkt/obj1", id1));
+    REQUIRE(count_uploads() == 0);
+    REQUIRE(transport->GetSize("bkt/obj1") == 8192);
+    REQUIRE(other->GetSize("bkt/obj2") == 8192);
+    std::string buf(8192, 0);
+    struct iovec out = {&buf[0], buf.size()};
+    REQUIRE(transport->GetRange("bkt/obj1", 0, &out, 1) == 8192);
+    REQUIRE(buf == part1 + part1);
+    REQUIRE(other->GetRange("bkt/obj2", 0, &out, 1) == 8192);
+    REQUIRE(buf == std::string(4096, 0) + part2);
+  }
+}
@@ -0,0 +1,76 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "basic_test.h"
+#include "hermes/hermes_types.h"
+
+typedef std::vector<std::pair<size_t, size_t>> RANGES_T;
+
+TEST_CASE("TestByteRangeSet") {
+  hermes::ByteRangeSet set;
+
+  PAGE_DIVIDE("Empty ranges are ignored") {
+    set.Add(10, 0);
+    REQUIRE(set.empty());
+    REQUIRE(set.GetSize() == 0);
+  }
+
+  PAGE_DIVIDE("Disjoint ranges stay sorted") {
+    set.Add(100, 10);
+    set.Add(0, 10);
+    set.Add(50, 10);
+    REQUIRE(set.ranges_ == RANGES_T{{0, 10}, {50, 60}, {100, 110}});
+    REQUIRE(set.GetSize() == 30);
+  }
+
+  PAGE_DIVIDE("Adjacent ranges merge on either side") {
+    set.clear();
+    set.Add(10, 10);
+    set.Add(20, 10);
+    set.Add(0, 10);
+    REQUIRE(set.ranges_ == RANGES_T{{0, 30}});
+  }
+
+  PAGE_DIVIDE("Contained ranges change nothing") {
+    set.Add(22, 3);
+    set.Add(0, 30);
+    REQUIRE(set.ranges_ == RANGES_T{{0, 30}});
+  }
+
+  PAGE_DIVIDE("A range spanning several merges them") {
+    set.clear();
+    set.Add(0, 10);
+    set.Add(20, 10);
+    set.Add(40, 10);
+    set.Add(70, 10);
+    set.Add(5, 40);
+    REQUIRE(set.ranges_ == RANGES_T{{0, 50}, {70, 80}});
+    set.Add(49, 22);
+    REQUIRE(set.ranges_ == RANGES_T{{0, 80}});
+  }
+
+  PAGE_DIVIDE("Partial overlaps extend the range") {
+    set.clear();
+    set.Add(20, 10);
+    set.Add(15, 10);
+    set.Add(25, 10);
+    REQUIRE(set.ranges_ == RANGES_T{{15, 35}});
+    REQUIRE(set.GetSize() == 20);
+  }
+
+  PAGE_DIVIDE("Swap") {
+    hermes::ByteRangeSet other;
+    other.swap(set);
+    REQUIRE(set.empty());
+    REQUIRE(other.GetSize() == 20);
+  }
+}
@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <random>
+#include <string>
+
+#include "basic_test.h"
+#include "hermes/compressor.h"
+
+/** Text-like data: a few words in a random order */
+static std::string MakeText(size_t size) {
+  const char *words[] = {"hermes ", "buffer ", "blob ", "tier ", "stage "};
+  std::mt19937 rng(7);
+  std::string text;
+  while (text.size() < size) {
+    text += words[rng() % 5];
+  }
+  text.resize(size);
+  return text;
+}
+
+TEST_CASE("TestCompressor") {
+  const size_t kSize = 64 * 1024;
+  std::string text = MakeText(kSize);
+  std::string noise(kSize, 0);
+  std::mt19937 rng(11);
+  for (char &c : noise) {
+    c = (char)rng();
+  }
+
+  PAGE_DIVIDE("Entropy check") {
+    REQUIRE(!hermes::Compressor::IsCompressible(text.data(), 0));
+    REQUIRE(hermes::Compressor::IsCompressible(text.data(), kSize));
+    REQUIRE(hermes::Compressor::IsCompressible(std::string(kSize, 0).data(),
+                                               kSize));
+    REQUIRE(!hermes::Compressor::IsCompressible(noise.data(), kSize));
+  }
+
+  PAGE_DIVIDE("Codecs") {
+    REQUIRE(hermes::Compressor::FromString("none") ==
+            hermes::CompressCodec::kNone);
+    REQUIRE(hermes::Compressor::FromString("gzip") ==
+            hermes::CompressCodec::kNone);
+    char out[16];
+    REQUIRE(hermes::Compressor::Compress(hermes::CompressCodec::kNone,
+                                         text.data(), 16, out, 16) == 0);
+  }
+
+  for (hermes::CompressCodec codec :
+       {hermes::CompressCodec::kLz4, hermes::CompressCodec::kZstd}) {
+    if (!hermes::Compressor::IsAvailable(codec)) {
+      continue;
+    }
+    std::string comp(hermes::Compressor::GetBound(codec, kSize), 0);
+    size_t comp_size = hermes::Compressor::Compress(
+        codec, text.data(), kSize, &comp[0], comp.size());
+
+    PAGE_DIVIDE("Round trip") {
+      REQUIRE(comp_size > 0);
+      REQUIRE(comp_size < kSize);
+      std::string raw(kSize, 0);
+      REQUIRE(hermes::Compressor::Decompress(codec, comp.data(), comp_size,
+                                             &raw[0], kSize) == kSize);
+      REQUIRE(raw == text);
+    }
+
+    PAGE_DIVIDE("Partial decode stops at the prefix") {
+      std::string raw(kSize, 0);
+      size_t prefix = kSize / 3 + 5;
+      REQUIRE(hermes::Compressor::Decompress(codec, comp.data(), comp_size,
+                                             &raw[0], prefix) == prefix);
+      REQUIRE(raw.substr(0, prefix) == text.substr(0, prefix));
+      REQUIRE(raw.substr(prefix) == std::string(kSize - prefix, 0));
+    }
+
+    PAGE_DIVIDE("Output that doesn't fit fails") {
+      std::string small(64, 0);
+      REQUIRE(hermes::Compressor::Compress(codec, noise.data(), kSize,
+                                           &small[0], small.size()) == 0);
+    }
+  }
+}
@@ -0,0 +1,76 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "basic_test.h"
+#include "hermes/rcu_map.h"
+
+TEST_CASE("TestRcuMap") {
+  hermes::RcuMap<int, std::shared_ptr<int>> map;
+  std::shared_ptr<int> val;
+
+  PAGE_DIVIDE("Emplace, Get, and Erase") {
+    REQUIRE(!map.Get(1, val));
+    REQUIRE(map.Emplace(1, std::make_shared<int>(10)));
+    REQUIRE(!map.Emplace(1, std::make_shared<int>(20)));
+    REQUIRE(map.Get(1, val));
+    REQUIRE(*val == 10);
+    REQUIRE(map.Erase(1));
+    REQUIRE(!map.Erase(1));
+    REQUIRE(!map.Get(1, val));
+    // A value copied out outlives its removal from the map
+    REQUIRE(*val == 10);
+  }
+
+  PAGE_DIVIDE("Readers see whole snapshots while a writer churns") {
+    const int kKeys = 64;
+    const int kRounds = 8;
+    for (int key = 0; key < kKeys; key += 2) {
+      map.Emplace(key, std::make_shared<int>(key));
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> bad(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i) {
+      readers.emplace_back([&map, &stop, &bad] {
+        std::shared_ptr<int> found;
+        while (!stop.load()) {
+          for (int key = 0; key < kKeys; ++key) {
+            // Even keys are never erased, odd keys come and go
+            bool has = map.Get(key, found);
+            if ((key % 2 == 0 && !has) || (has && *found != key)) {
+              ++bad;
+            }
+          }
+        }
+      });
+    }
+    for (int round = 0; round < kRounds; ++round) {
+      for (int key = 1; key < kKeys; key += 2) {
+        map.Emplace(key, std::make_shared<int>(key));
+      }
+      for (int key = 1; key < kKeys; key += 2) {
+        map.Erase(key);
+      }
+    }
+    stop = true;
+    for (std::thread &reader : readers) {
+      reader.join();
+    }
+    REQUIRE(bad.load() == 0);
+    REQUIRE(!map.Get(1, val));
+    REQUIRE(map.Get(kKeys - 2, val));
+  }
+}
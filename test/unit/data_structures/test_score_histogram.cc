@@ -0,0 +1,51 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "basic_test.h"
+#include "hermes/score_histogram.h"
+
+TEST_CASE("TestScoreHistogram") {
+  hermes::Histogram hist;
+  hist.Resize(10, 4);
+
+  PAGE_DIVIDE("Empty histogram") {
+    REQUIRE(hist.GetCount() == 0);
+    REQUIRE(hist.GetPercentile(.5) == 100);
+    REQUIRE(hist.GetQuantile(50) == 0);
+  }
+
+  PAGE_DIVIDE("Percentiles merge every lane") {
+    for (int i = 0; i < 10; ++i) {
+      hist.Increment(i / 10.0f + .05f, i);
+    }
+    REQUIRE(hist.GetCount() == 10);
+    REQUIRE(hist.GetPercentile(0) == 0);
+    REQUIRE(hist.GetPercentile(.05) == 10);
+    REQUIRE(hist.GetPercentileLT(.05) == 0);
+    REQUIRE(hist.GetPercentile(.55) == 60);
+    REQUIRE(hist.GetPercentile(1) == 100);
+  }
+
+  PAGE_DIVIDE("Quantiles are fractional") {
+    REQUIRE(hist.GetQuantile(10) == Catch::Approx(.1));
+    REQUIRE(hist.GetQuantile(45) == Catch::Approx(.5));
+    REQUIRE(hist.GetQuantile(100) == Catch::Approx(1));
+  }
+
+  PAGE_DIVIDE("Decrements from another lane") {
+    hist.Decrement(.95, 0);
+    hist.Decrement(.85, 3);
+    REQUIRE(hist.GetCount() == 8);
+    REQUIRE(hist.GetPercentile(.75) == 100);
+    REQUIRE(hist.GetQuantile(100) == Catch::Approx(.8));
+  }
+}
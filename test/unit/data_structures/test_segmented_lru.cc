@@ -0,0 +1,64 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "basic_test.h"
+#include "hermes/segmented_lru.h"
+
+TEST_CASE("TestSegmentedLru") {
+  hermes::SegmentedLru<int> lru(.5);
+  int key;
+
+  PAGE_DIVIDE("Victims come from probation first") {
+    for (int i = 1; i <= 4; ++i) {
+      lru.Touch(i);
+    }
+    lru.Touch(1);
+    lru.Touch(2);
+    REQUIRE(lru.IsProtected(1));
+    REQUIRE(lru.IsProtected(2));
+    // The protected segment holds at most half of the keys
+    lru.Touch(3);
+    REQUIRE(lru.IsProtected(3));
+    REQUIRE(!lru.IsProtected(1));
+    std::vector<int> order;
+    while (lru.PopVictim(key)) {
+      order.emplace_back(key);
+    }
+    REQUIRE(order == std::vector<int>{4, 1, 2, 3});
+    REQUIRE(lru.size() == 0);
+  }
+
+  PAGE_DIVIDE("A scan does not evict reused keys") {
+    lru.Touch(1);
+    lru.Touch(1);
+    for (int i = 10; i < 14; ++i) {
+      lru.Touch(i);
+    }
+    REQUIRE(lru.PopVictim(key));
+    REQUIRE(key == 10);
+    REQUIRE(lru.Contains(1));
+  }
+
+  PAGE_DIVIDE("Erase and PushCold") {
+    lru = hermes::SegmentedLru<int>(.5);
+    lru.Touch(1);
+    lru.Touch(2);
+    lru.Erase(1);
+    lru.Erase(7);
+    REQUIRE(!lru.Contains(1));
+    lru.PushCold(3);
+    lru.PushCold(2);
+    REQUIRE(lru.size() == 2);
+    REQUIRE(lru.PopVictim(key));
+    REQUIRE(key == 3);
+  }
+}
@@ -0,0 +1,33 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "basic_test.h"
+#include "hermes/stream_detector.h"
+
+TEST_CASE("TestStreamDetector") {
+  hermes::StreamDetector<int> stream(4);
+
+  PAGE_DIVIDE("First touches form a stream") {
+    for (int i = 0; i < 3; ++i) {
+      REQUIRE(!stream.Record(i, true));
+    }
+    // Repeated accesses to the last blob don't count
+    REQUIRE(!stream.Record(2, true));
+    REQUIRE(stream.Record(3, true));
+  }
+
+  PAGE_DIVIDE("Reuse halves the run") {
+    REQUIRE(!stream.Record(0, false));
+    REQUIRE(!stream.Record(4, true));
+    REQUIRE(stream.Record(5, true));
+  }
+}
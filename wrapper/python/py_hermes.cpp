@@ -86,7 +86,10 @@ void BindTargetStats(py::module &m) {
       .def_readonly("max_cap", &TargetStats::max_cap_)
       .def_readonly("bandwidth", &TargetStats::bandwidth_)
       .def_readonly("latency", &TargetStats::latency_)
-      .def_readonly("score", &TargetStats::score_);
+      .def_readonly("score", &TargetStats::score_)
+      .def_readonly("raw_bytes", &TargetStats::raw_bytes_)
+      .def_readonly("stored_bytes", &TargetStats::stored_bytes_)
+      .def_readonly("effective_cap", &TargetStats::effective_cap_);
 }
 
 void BindTagInfo(py::module &m) {